@@ -0,0 +1,223 @@
+#include <debugger/debugger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace debugger;
+
+// Counts global allocations while the debugger is in steady state: after a
+// warm-up rounds have filled the batch pool, the staging buffers and the
+// per-thread caches, the same traffic is sent again and every operator new
+// on any thread (producers and lanes alike) is counted until flush()
+// reports it delivered.
+//
+// The typed-field paths must not allocate at all; the process exits with 1
+// if they do. The json paths are listed for comparison: there the caller
+// builds the json, and json handlers get a fresh json per record.
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<bool> g_counting{false};
+
+void* counted_new(std::size_t size) {
+    if (g_counting.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* counted_new(std::size_t size, std::align_val_t align) {
+    if (g_counting.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    const auto alignment = static_cast<std::size_t>(align);
+    if (void* p = std::aligned_alloc(alignment, (std::max<std::size_t>(size, 1) + alignment - 1) & ~(alignment - 1))) return p;
+    throw std::bad_alloc();
+}
+
+struct CountingSink : Sink {
+    std::atomic<uint64_t> records{0};
+    void write(std::span<const RecordView> batch, const BatchInfo&) override {
+        records.fetch_add(batch.size(), std::memory_order_relaxed);
+    }
+};
+
+struct Result {
+    std::string path;
+    uint64_t messages{0};
+    uint64_t allocations{0};
+    bool must_be_zero{false};
+};
+
+// Producer threads kept for the whole run, so thread start-up and their
+// staging buffers are not counted
+class Producers {
+public:
+    explicit Producers(size_t count) {
+        for (size_t p = 0; p < count; ++p) {
+            threads_.emplace_back([this, p] { run(p); });
+        }
+    }
+
+    ~Producers() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : threads_) {
+            t.join();
+        }
+    }
+
+    size_t size() const { return threads_.size(); }
+
+    // Run work(producer) on every thread and wait for all of them
+    void run_round(const std::function<void(size_t)>& work) {
+        std::unique_lock lock(mutex_);
+        work_ = &work;
+        busy_ = threads_.size();
+        ++round_;
+        cv_.notify_all();
+        done_.wait(lock, [&] { return busy_ == 0; });
+    }
+
+private:
+    void run(size_t p) {
+        uint64_t seen = 0;
+        for (;;) {
+            const std::function<void(size_t)>* work;
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, [&] { return stopping_ || round_ != seen; });
+                if (stopping_) return;
+                seen = round_;
+                work = work_;
+            }
+            (*work)(p);
+            std::lock_guard lock(mutex_);
+            if (--busy_ == 0) done_.notify_one();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable done_;
+    const std::function<void(size_t)>* work_{nullptr};
+    uint64_t round_{0};
+    size_t busy_{0};
+    bool stopping_{false};
+    std::vector<std::thread> threads_;
+};
+
+// Send the traffic three times; count the last round
+template<typename Send>
+Result measure(std::string path, bool must_be_zero, Producers& producers, size_t messages, Send send) {
+    auto& dbg = Debugger::instance();
+    const std::function<void(size_t)> work = [&](size_t p) {
+        for (size_t i = 0; i < messages; ++i) {
+            send(p, i);
+        }
+    };
+    uint64_t allocations = 0;
+    for (int round = 0; round < 3; ++round) {
+        if (round == 2) {
+            g_allocations.store(0);
+            g_counting.store(true);
+        }
+        producers.run_round(work);
+        stdexec::sync_wait(dbg.flush());
+        if (round == 2) {
+            g_counting.store(false);
+            allocations = g_allocations.load();
+        }
+    }
+    return {std::move(path), producers.size() * messages, allocations, must_be_zero};
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return counted_new(size); }
+void* operator new[](std::size_t size) { return counted_new(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return counted_new(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return counted_new(size, align); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+    const size_t messages = argc > 1 ? std::stoul(argv[1]) : 100000;
+    Producers producers(4);
+
+    auto& dbg = Debugger::instance();
+    Debugger::Options options;
+    options.num_threads = 2;
+    options.queue_capacity = 1 << 12;
+    dbg.init(options);
+
+    std::atomic<uint64_t> handled{0};
+    dbg.register_record_handler("alloc.records", [&](const RecordView&) {
+        handled.fetch_add(1, std::memory_order_relaxed);
+    });
+    dbg.register_handler("alloc.json", [&](const json&) {
+        handled.fetch_add(1, std::memory_order_relaxed);
+    });
+    auto sink = std::make_shared<CountingSink>();
+    dbg.add_sink("alloc.sink.**", sink);
+    auto subitem = dbg.create_subitem("Worker", "alloc.sink");
+    Category& records = dbg.intern_category("alloc.records");
+    const std::string payload = "a payload longer than the small string buffer";
+
+    std::vector<Result> results;
+    results.push_back(measure("emit -> record handler", true, producers, messages, [&](size_t p, size_t i) {
+        dbg.emit(records, Level::info, "request completed", field("producer", p), field("seq", i),
+                 field("payload", std::string_view(payload)));
+    }));
+    results.push_back(measure("subitem emit -> sink", true, producers, messages, [&](size_t p, size_t i) {
+        subitem->emit(Level::info, "request completed", field("producer", p), field("seq", i));
+    }));
+    results.push_back(measure("span -> sink", true, producers, messages, [&](size_t, size_t) {
+        auto span = subitem->span("request");
+    }));
+    results.push_back(measure("DEBUG_LOG json -> record handler", false, producers, messages, [&](size_t p, size_t i) {
+        DEBUG_LOG("alloc.records", "request completed", {"producer", p}, {"seq", i});
+    }));
+    results.push_back(measure("send_message json -> json handler", false, producers, messages, [&](size_t p, size_t i) {
+        dbg.send_message("alloc.json", "request completed", {{"producer", p}, {"seq", i}});
+    }));
+    dbg.shutdown();
+
+    std::cout << "=== Allocation Benchmark (" << producers.size() << " producers x " << messages
+              << " messages, after warm-up) ===\n\n"
+              << std::left << std::setw(36) << "path" << std::right
+              << std::setw(14) << "allocations"
+              << std::setw(14) << "per message" << std::endl;
+    bool ok = true;
+    for (const auto& result : results) {
+        std::cout << std::left << std::setw(36) << result.path << std::right
+                  << std::setw(14) << result.allocations
+                  << std::setw(14) << std::fixed << std::setprecision(3)
+                  << static_cast<double>(result.allocations) / static_cast<double>(result.messages)
+                  << (result.must_be_zero && result.allocations != 0 ? "  <- expected none" : "") << std::endl;
+        ok = ok && (!result.must_be_zero || result.allocations == 0);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include <debugger/debugger.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace debugger;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+// Measures dispatch throughput as init(num_threads) grows while every
+// category has a slow handler. Also checks that each category still sees
+// its messages in the order they were sent.
+
+namespace {
+
+constexpr size_t kLaneCounts[] = {1, 2, 4, 8};
+constexpr size_t kCategories = 16;
+constexpr size_t kProducers = 4;
+
+struct CategoryState {
+    // Only touched by the lane that owns the category
+    std::array<int64_t, kProducers> last_seq{};
+    size_t order_violations = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t messages_per_producer = 2000;
+    auto handler_cost = 50us;
+    if (argc > 1) {
+        messages_per_producer = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        handler_cost = std::chrono::microseconds(std::stoul(argv[2]));
+    }
+
+    auto& dbg = Debugger::instance();
+    std::array<CategoryState, kCategories> states;
+    std::vector<Category*> categories;
+    std::atomic<size_t> handled{0};
+
+    for (size_t c = 0; c < kCategories; ++c) {
+        const std::string name = "bench.category" + std::to_string(c);
+        categories.push_back(&dbg.intern_category(name));
+
+        // Simulates a sink doing I/O: the handler blocks for handler_cost
+        dbg.register_record_handler(name, [&, c](const RecordView& record) {
+            int64_t producer = 0;
+            int64_t seq = 0;
+            record.for_each_field([&](const FieldView& f) {
+                if (f.key() == "producer") producer = f.as_int();
+                if (f.key() == "seq") seq = f.as_int();
+            });
+            auto& state = states[c];
+            if (seq <= state.last_seq[producer]) {
+                ++state.order_violations;
+            }
+            state.last_seq[producer] = seq;
+
+            std::this_thread::sleep_for(handler_cost);
+            handled.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    std::cout << "=== Dispatch Benchmark (" << kProducers << " producers x "
+              << messages_per_producer << " messages, " << kCategories << " categories, "
+              << handler_cost.count() << "us handlers) ===\n"
+              << std::setw(10) << "lanes"
+              << std::setw(14) << "seconds"
+              << std::setw(14) << "msgs/s"
+              << std::setw(12) << "speedup"
+              << std::setw(14) << "misordered" << std::endl;
+
+    double baseline = 0;
+    for (size_t lanes : kLaneCounts) {
+        for (auto& state : states) {
+            state = CategoryState{};
+        }
+        handled.store(0);
+
+        Debugger::Options options;
+        options.num_threads = lanes;
+        dbg.init(options);
+
+        const size_t total = kProducers * messages_per_producer;
+        const auto start = Clock::now();
+
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < kProducers; ++p) {
+            producers.emplace_back([&, p] {
+                for (size_t i = 0; i < messages_per_producer; ++i) {
+                    dbg.emit(*categories[i % kCategories], Level::info, "work",
+                        field("producer", static_cast<int64_t>(p)),
+                        field("seq", static_cast<int64_t>(i + 1)));
+                }
+            });
+        }
+        for (auto& t : producers) {
+            t.join();
+        }
+
+        // shutdown() drains every lane before returning
+        dbg.shutdown();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        size_t violations = 0;
+        for (const auto& state : states) {
+            violations += state.order_violations;
+        }
+        if (baseline == 0) {
+            baseline = seconds;
+        }
+
+        std::cout << std::setw(10) << lanes
+                  << std::setw(14) << std::fixed << std::setprecision(3) << seconds
+                  << std::setw(14) << std::setprecision(0) << static_cast<double>(handled.load()) / seconds
+                  << std::setw(11) << std::setprecision(2) << baseline / seconds << "x"
+                  << std::setw(14) << violations << std::endl;
+
+        if (handled.load() != total) {
+            std::cerr << "lost messages: handled " << handled.load() << " of " << total << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
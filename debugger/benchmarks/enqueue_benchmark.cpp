@@ -0,0 +1,137 @@
+#include <debugger/debugger.hpp>
+#include <debugger/ring_buffer.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace debugger;
+using Clock = std::chrono::steady_clock;
+
+// Measures the producer-side cost of an enqueue as the number of producer
+// threads grows. Each producer times its own loop, so the reported figure is
+// the average latency a caller pays per enqueue, not aggregate throughput.
+
+namespace {
+
+constexpr size_t kProducerCounts[] = {1, 2, 4, 8, 16, 32, 64};
+
+struct Result {
+    double ns_per_op;
+    double total_mops;
+};
+
+template<typename Produce>
+Result run_producers(size_t producers, size_t ops_per_producer, Produce produce) {
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> total_ns{0};
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            auto start = Clock::now();
+            for (size_t i = 0; i < ops_per_producer; ++i) {
+                produce(p, i);
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+            total_ns.fetch_add(static_cast<uint64_t>(elapsed.count()));
+        });
+    }
+
+    auto wall_start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto wall = std::chrono::duration<double>(Clock::now() - wall_start).count();
+
+    const double ops = static_cast<double>(producers * ops_per_producer);
+    return {
+        static_cast<double>(total_ns.load()) / ops,
+        ops / wall / 1e6
+    };
+}
+
+void print_row(size_t producers, const Result& r) {
+    std::cout << std::setw(10) << producers
+              << std::setw(16) << std::fixed << std::setprecision(1) << r.ns_per_op
+              << std::setw(16) << std::setprecision(2) << r.total_mops << std::endl;
+}
+
+void print_header(const char* title) {
+    std::cout << "\n--- " << title << " ---\n"
+              << std::setw(10) << "producers"
+              << std::setw(16) << "ns/enqueue"
+              << std::setw(16) << "Mops/s" << std::endl;
+}
+
+// Raw ring: a single consumer drains continuously while producers push
+void bench_ring(size_t ops_per_producer) {
+    print_header("MpmcRing<uint64_t>::try_push");
+
+    for (size_t producers : kProducerCounts) {
+        MpmcRing<uint64_t> ring(1 << 16);
+        std::atomic<bool> done{false};
+        std::thread consumer([&] {
+            uint64_t value = 0;
+            while (!done.load(std::memory_order_acquire) || !ring.empty()) {
+                if (!ring.try_pop(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        auto result = run_producers(producers, ops_per_producer, [&](size_t p, size_t i) {
+            const uint64_t value = (static_cast<uint64_t>(p) << 32) | i;
+            while (!ring.try_push(value)) {
+                std::this_thread::yield();
+            }
+        });
+
+        done.store(true, std::memory_order_release);
+        consumer.join();
+        print_row(producers, result);
+    }
+}
+
+// Full send_message path with a no-op handler on the dispatcher
+void bench_send_message(size_t ops_per_producer) {
+    print_header("Debugger::send_message");
+
+    auto& dbg = Debugger::instance();
+    dbg.register_handler("bench", [](const json&) {});
+
+    for (size_t producers : kProducerCounts) {
+        Debugger::Options options;
+        options.queue_capacity = 1 << 18;
+        dbg.init(options);
+
+        auto result = run_producers(producers, ops_per_producer, [&](size_t, size_t i) {
+            dbg.send_message("bench", "tick", {{"i", i}});
+        });
+
+        dbg.shutdown();
+        print_row(producers, result);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t ops = 200000;
+    if (argc > 1) {
+        ops = std::stoul(argv[1]);
+    }
+
+    std::cout << "=== Enqueue Benchmark (" << ops << " ops per producer) ===" << std::endl;
+    bench_ring(ops);
+    bench_send_message(ops / 10);
+    return 0;
+}
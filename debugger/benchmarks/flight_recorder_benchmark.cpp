@@ -0,0 +1,102 @@
+#include <debugger/debugger.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace debugger;
+using Clock = std::chrono::steady_clock;
+
+// Measures what the flight recorder adds to the producer side of emit. The
+// recorder stays on once enabled, so every producer count is run first
+// without it and then again with it.
+
+namespace {
+
+constexpr size_t kProducerCounts[] = {1, 2, 4, 8};
+
+// Average nanoseconds a producer spends per emit
+double run_producers(size_t producers, size_t ops_per_producer, Category& category) {
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> total_ns{0};
+    std::vector<std::thread> threads;
+
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            auto start = Clock::now();
+            for (size_t i = 0; i < ops_per_producer; ++i) {
+                Debugger::instance().emit(category, Level::info, "request completed",
+                    field("producer", static_cast<int64_t>(p)),
+                    field("seq", static_cast<int64_t>(i)),
+                    field("url", "/api/users"));
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+            total_ns.fetch_add(static_cast<uint64_t>(elapsed.count()));
+        });
+    }
+
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    return static_cast<double>(total_ns.load()) / static_cast<double>(producers * ops_per_producer);
+}
+
+std::vector<double> run_all(size_t ops_per_producer) {
+    auto& dbg = Debugger::instance();
+    std::vector<double> results;
+    for (size_t producers : kProducerCounts) {
+        Debugger::Options options;
+        options.queue_capacity = 1 << 18;
+        dbg.init(options);
+        results.push_back(run_producers(producers, ops_per_producer, dbg.intern_category("bench")));
+        dbg.shutdown();
+    }
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t ops = 200000;
+    if (argc > 1) {
+        ops = std::stoul(argv[1]);
+    }
+
+    auto& dbg = Debugger::instance();
+    dbg.register_record_handler("bench", [](const RecordView&) {});
+
+    const auto without = run_all(ops);
+
+    FlightRecorderOptions options;
+    options.path = std::filesystem::temp_directory_path() / "flight_recorder_benchmark.flight";
+    options.size = size_t{64} << 20;
+    options.stripes = 8;
+    if (!dbg.enable_flight_recorder(options)) {
+        std::cerr << "could not create " << options.path << std::endl;
+        return 1;
+    }
+    const auto with = run_all(ops);
+
+    std::cout << "=== Flight Recorder Benchmark (" << ops << " emits per producer) ===\n"
+              << std::setw(10) << "producers"
+              << std::setw(16) << "ns/emit off"
+              << std::setw(16) << "ns/emit on"
+              << std::setw(16) << "overhead ns" << std::endl;
+    for (size_t i = 0; i < std::size(kProducerCounts); ++i) {
+        std::cout << std::setw(10) << kProducerCounts[i]
+                  << std::setw(16) << std::fixed << std::setprecision(1) << without[i]
+                  << std::setw(16) << with[i]
+                  << std::setw(16) << with[i] - without[i] << std::endl;
+    }
+
+    std::filesystem::remove(options.path);
+    return 0;
+}
@@ -0,0 +1,306 @@
+#include <debugger/debugger.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace debugger;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+// Regression suite for the three numbers users feel:
+//   - how long send_message and DebugSubitem::log_info block the caller
+//     (p50/p99/p999 per call)
+//   - sustained throughput as producers and init(num_threads) vary
+//   - producer-to-handler latency, with and without slow handlers sharing
+//     the lanes
+// With --json the results are printed as one JSON document instead of
+// tables, for tracking over time.
+
+namespace {
+
+constexpr size_t kLatencyProducers[] = {1, 4};
+constexpr size_t kThroughputProducers[] = {1, 2, 4, 8};
+constexpr size_t kThroughputLanes[] = {1, 2, 4};
+constexpr size_t kThroughputCategories = 16;
+constexpr size_t kSlowCategories = 4;
+constexpr auto kSlowHandlerCost = 200us;
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count());
+}
+
+struct Percentiles {
+    size_t samples{0};
+    double p50{0};
+    double p99{0};
+    double p999{0};
+    double max{0};
+};
+
+Percentiles summarize(std::vector<uint64_t>& ns) {
+    Percentiles result;
+    result.samples = ns.size();
+    if (ns.empty()) return result;
+    std::sort(ns.begin(), ns.end());
+    const auto at = [&](double q) {
+        return static_cast<double>(ns[static_cast<size_t>(q * static_cast<double>(ns.size() - 1))]);
+    };
+    result.p50 = at(0.50);
+    result.p99 = at(0.99);
+    result.p999 = at(0.999);
+    result.max = static_cast<double>(ns.back());
+    return result;
+}
+
+nlohmann::json to_json(const Percentiles& p) {
+    return {{"samples", p.samples}, {"p50_ns", p.p50}, {"p99_ns", p.p99}, {"p999_ns", p.p999}, {"max_ns", p.max}};
+}
+
+void print_percentiles_header(const char* title, const char* first_column) {
+    std::cout << "\n--- " << title << " ---\n"
+              << std::setw(22) << first_column
+              << std::setw(12) << "p50 ns"
+              << std::setw(12) << "p99 ns"
+              << std::setw(12) << "p999 ns"
+              << std::setw(12) << "max ns" << std::endl;
+}
+
+void print_percentiles(const std::string& label, const Percentiles& p) {
+    std::cout << std::setw(22) << label << std::fixed << std::setprecision(0)
+              << std::setw(12) << p.p50
+              << std::setw(12) << p.p99
+              << std::setw(12) << p.p999
+              << std::setw(12) << p.max << std::endl;
+}
+
+// Run producers in lockstep; each records the latency of every call
+template<typename Call>
+std::vector<uint64_t> time_calls(size_t producers, size_t calls_per_producer, Call call) {
+    std::atomic<bool> go{false};
+    std::vector<std::vector<uint64_t>> samples(producers);
+    std::vector<std::thread> threads;
+
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            auto& mine = samples[p];
+            mine.reserve(calls_per_producer);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < calls_per_producer; ++i) {
+                const auto start = Clock::now();
+                call(p, i);
+                mine.push_back(static_cast<uint64_t>((Clock::now() - start).count()));
+            }
+        });
+    }
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<uint64_t> all;
+    for (auto& mine : samples) {
+        all.insert(all.end(), mine.begin(), mine.end());
+    }
+    return all;
+}
+
+void wait_for(const std::atomic<size_t>& counter, size_t target) {
+    const auto deadline = Clock::now() + 60s;
+    while (counter.load(std::memory_order_relaxed) < target && Clock::now() < deadline) {
+        std::this_thread::sleep_for(50us);
+    }
+}
+
+nlohmann::json bench_call_latency(size_t calls, bool tables) {
+    auto& dbg = Debugger::instance();
+    dbg.register_record_handler("bench.latency", [](const RecordView&) {});
+    auto subitem = dbg.create_subitem("Latency", "bench");
+    dbg.register_record_handler("bench.Latency", [](const RecordView&) {});
+
+    nlohmann::json results = nlohmann::json::array();
+    if (tables) print_percentiles_header("Producer call latency", "call / producers");
+
+    for (std::string_view api : {"send_message", "log_info"}) {
+        for (size_t producers : kLatencyProducers) {
+            Debugger::Options options;
+            options.num_threads = 2;
+            options.queue_capacity = 1 << 18;
+            dbg.init(options);
+
+            auto samples = time_calls(producers, calls, [&](size_t p, size_t i) {
+                if (api == "send_message") {
+                    dbg.send_message("bench.latency", "request completed", {{"producer", p}, {"seq", i}});
+                } else {
+                    subitem->log_info("request completed", {{"producer", p}, {"seq", i}});
+                }
+            });
+            dbg.shutdown();
+
+            const auto p = summarize(samples);
+            if (tables) print_percentiles(std::string(api) + " / " + std::to_string(producers), p);
+            auto row = to_json(p);
+            row["api"] = api;
+            row["producers"] = producers;
+            results.push_back(std::move(row));
+        }
+    }
+    return results;
+}
+
+nlohmann::json bench_throughput(size_t messages_per_producer, bool tables) {
+    auto& dbg = Debugger::instance();
+    std::atomic<size_t> handled{0};
+    std::vector<std::string> names;
+    for (size_t c = 0; c < kThroughputCategories; ++c) {
+        names.push_back("bench.throughput" + std::to_string(c));
+        dbg.register_record_handler(names.back(), [&](const RecordView&) {
+            handled.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    nlohmann::json results = nlohmann::json::array();
+    if (tables) {
+        std::cout << "\n--- Sustained send_message throughput ---\n"
+                  << std::setw(12) << "producers"
+                  << std::setw(8) << "lanes"
+                  << std::setw(14) << "msgs/s" << std::endl;
+    }
+
+    for (size_t lanes : kThroughputLanes) {
+        for (size_t producers : kThroughputProducers) {
+            Debugger::Options options;
+            options.num_threads = lanes;
+            options.queue_capacity = 1 << 16;
+            dbg.init(options);
+            handled.store(0);
+
+            const auto start = Clock::now();
+            time_calls(producers, messages_per_producer, [&](size_t p, size_t i) {
+                dbg.send_message(names[(p + i) % names.size()], "tick", {{"seq", i}});
+            });
+            const size_t total = producers * messages_per_producer;
+            wait_for(handled, total);
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            dbg.shutdown();
+
+            const double rate = static_cast<double>(handled.load()) / seconds;
+            if (tables) {
+                std::cout << std::setw(12) << producers
+                          << std::setw(8) << lanes
+                          << std::setw(14) << std::fixed << std::setprecision(0) << rate << std::endl;
+            }
+            results.push_back({{"producers", producers}, {"lanes", lanes}, {"messages", total},
+                               {"seconds", seconds}, {"messages_per_second", rate}});
+        }
+    }
+    return results;
+}
+
+nlohmann::json bench_end_to_end(size_t messages, bool tables) {
+    auto& dbg = Debugger::instance();
+
+    // The handler runs on a single lane, so the samples need no lock
+    std::vector<uint64_t> samples;
+    std::atomic<size_t> received{0};
+    dbg.register_record_handler("bench.e2e", [&](const RecordView& record) {
+        const uint64_t now = now_ns();
+        record.for_each_field([&](const FieldView& f) {
+            if (f.key() == "sent") samples.push_back(now - f.as_uint());
+        });
+        received.fetch_add(1, std::memory_order_release);
+    });
+    for (size_t c = 0; c < kSlowCategories; ++c) {
+        dbg.register_record_handler("bench.slow" + std::to_string(c), [](const RecordView&) {
+            std::this_thread::sleep_for(kSlowHandlerCost);
+        });
+    }
+
+    nlohmann::json results = nlohmann::json::array();
+    if (tables) print_percentiles_header("Producer-to-handler latency (2 lanes)", "scenario");
+
+    for (bool slow : {false, true}) {
+        Debugger::Options options;
+        options.num_threads = 2;
+        dbg.init(options);
+        samples.clear();
+        samples.reserve(messages);
+        received.store(0);
+
+        // Slow traffic on every lane, at about what the slow handlers can take
+        std::atomic<bool> stop{false};
+        std::thread background;
+        if (slow) {
+            background = std::thread([&] {
+                for (size_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+                    dbg.send_message("bench.slow" + std::to_string(i % kSlowCategories), "slow", {{"seq", i}});
+                    std::this_thread::sleep_for(kSlowHandlerCost);
+                }
+            });
+        }
+
+        auto& category = dbg.intern_category("bench.e2e");
+        for (size_t i = 0; i < messages; ++i) {
+            dbg.emit(category, Level::info, "ping", field("sent", now_ns()));
+            std::this_thread::sleep_for(20us);
+        }
+        wait_for(received, messages);
+        stop.store(true);
+        if (background.joinable()) {
+            background.join();
+        }
+        dbg.shutdown();
+
+        const auto p = summarize(samples);
+        const char* scenario = slow ? "with slow handlers" : "fast handlers only";
+        if (tables) print_percentiles(scenario, p);
+        auto row = to_json(p);
+        row["scenario"] = scenario;
+        row["slow_handler_ns"] = std::chrono::nanoseconds(kSlowHandlerCost).count();
+        results.push_back(std::move(row));
+    }
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t messages = 100000;
+    bool json_output = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--json") {
+            json_output = true;
+        } else {
+            messages = std::stoul(argv[i]);
+        }
+    }
+    const bool tables = !json_output;
+
+    if (tables) {
+        std::cout << "=== Latency Benchmark (" << messages << " messages per run) ===" << std::endl;
+    }
+    nlohmann::json report = {
+        {"benchmark", "latency_benchmark"},
+        {"messages", messages},
+        {"hardware_threads", std::thread::hardware_concurrency()}
+    };
+    report["call_latency"] = bench_call_latency(messages, tables);
+    report["throughput"] = bench_throughput(messages, tables);
+    report["end_to_end"] = bench_end_to_end(std::max<size_t>(messages / 20, 100), tables);
+
+    if (json_output) {
+        std::cout << report.dump(2) << std::endl;
+    }
+    return 0;
+}
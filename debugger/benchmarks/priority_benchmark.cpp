@@ -0,0 +1,158 @@
+#include <debugger/debugger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace debugger;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+// Measures how long an error waits for its handler while the same
+// component floods the lane with debug records, with priority lanes and
+// with every level sharing one queue. The debug handler is slower than the
+// producers, so the lane stays saturated and its queue full for the whole
+// run. "passed" counts the debug records handled between an error being
+// sent and its handler, which unlike the latency does not depend on how
+// the OS schedules the lane's thread.
+
+namespace {
+
+constexpr size_t kBulkProducers = 2;
+constexpr auto kErrorInterval = 2ms;
+
+struct Run {
+    const char* name;
+    bool flood;
+    bool priority_lanes;
+};
+
+constexpr Run kRuns[] = {
+    {"idle", false, true},
+    {"flood, one queue", true, false},
+    {"flood, priority", true, true},
+};
+
+void spin_for(std::chrono::nanoseconds cost) {
+    const auto until = Clock::now() + cost;
+    while (Clock::now() < until) {
+    }
+}
+
+double at(const std::vector<uint64_t>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    return static_cast<double>(sorted[static_cast<size_t>(q * static_cast<double>(sorted.size() - 1))]);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    auto run_time = 2s;
+    auto handler_cost = 2000ns;
+    if (argc > 1) {
+        run_time = std::chrono::seconds(std::stoul(argv[1]));
+    }
+    if (argc > 2) {
+        handler_cost = std::chrono::nanoseconds(std::stoul(argv[2]));
+    }
+
+    auto& dbg = Debugger::instance();
+    auto worker = dbg.create_subitem("Worker", "bench");
+
+    // Only the lane's thread touches these while a run is going
+    std::vector<uint64_t> error_latency;
+    std::vector<uint64_t> passed;
+    std::atomic<uint64_t> bulk_handled{0};
+    dbg.register_record_handler(worker->category().name(), [&](const RecordView& record) {
+        if (record.level() == Level::error) {
+            const uint64_t now = RecordClock::now();
+            error_latency.push_back(now > record.timestamp() ? now - record.timestamp() : 0);
+            record.for_each_field([&](const FieldView& f) {
+                if (f.key() == "handled") passed.push_back(bulk_handled.load() - f.as_uint());
+            });
+        } else {
+            spin_for(handler_cost);
+            bulk_handled.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    std::cout << "=== Priority Benchmark (1 lane, " << kBulkProducers << " debug producers, "
+              << handler_cost.count() << "ns debug handler, an error every "
+              << kErrorInterval.count() << "ms) ===\n"
+              << std::setw(20) << "run"
+              << std::setw(10) << "errors"
+              << std::setw(14) << "p50 us"
+              << std::setw(14) << "p99 us"
+              << std::setw(14) << "max us"
+              << std::setw(12) << "passed p99"
+              << std::setw(14) << "debug/s" << std::endl;
+
+    for (const Run& run : kRuns) {
+        error_latency.clear();
+        error_latency.reserve(static_cast<size_t>(run_time / kErrorInterval) + 1);
+        passed.clear();
+        passed.reserve(error_latency.capacity());
+        bulk_handled.store(0);
+
+        Debugger::Options options;
+        options.num_threads = 1;
+        options.priority_lanes = run.priority_lanes;
+        dbg.init(options);
+
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> producers;
+        if (run.flood) {
+            for (size_t p = 0; p < kBulkProducers; ++p) {
+                producers.emplace_back([&, p] {
+                    for (int64_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+                        worker->emit(Level::debug, "cache probe",
+                            field("producer", static_cast<int64_t>(p)), field("seq", i));
+                    }
+                });
+            }
+        }
+
+        // Let the queue fill before the first error
+        std::this_thread::sleep_for(run.flood ? 200ms : 10ms);
+        const auto start = Clock::now();
+        size_t errors = 0;
+        for (auto next = start; next < start + run_time; next += kErrorInterval) {
+            std::this_thread::sleep_until(next);
+            worker->emit(Level::error, "request failed", field("attempt", static_cast<int64_t>(errors)),
+                         field("handled", bulk_handled.load()));
+            ++errors;
+        }
+        const uint64_t bulk = bulk_handled.load();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        stop.store(true);
+        for (auto& t : producers) {
+            t.join();
+        }
+        // shutdown() drains every lane before returning
+        dbg.shutdown();
+
+        std::sort(error_latency.begin(), error_latency.end());
+        std::sort(passed.begin(), passed.end());
+        std::cout << std::setw(20) << run.name
+                  << std::setw(10) << error_latency.size()
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(14) << at(error_latency, 0.50) / 1e3
+                  << std::setw(14) << at(error_latency, 0.99) / 1e3
+                  << std::setw(14) << at(error_latency, 1.0) / 1e3
+                  << std::setw(12) << std::setprecision(0) << at(passed, 0.99)
+                  << std::setw(14) << static_cast<double>(bulk) / seconds << std::endl;
+
+        if (error_latency.size() != errors) {
+            std::cerr << "lost errors: handled " << error_latency.size() << " of " << errors << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
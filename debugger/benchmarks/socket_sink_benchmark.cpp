@@ -0,0 +1,186 @@
+#include <debugger/debugger.hpp>
+#include <debugger/socket_sink.hpp>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace debugger;
+using Clock = std::chrono::steady_clock;
+
+// Streams messages to a loopback listener and reports how many per second
+// reach it, comparing an ad-hoc handler that dumps and sends each message on
+// its own with SocketSink's batched writes.
+
+namespace {
+
+constexpr size_t kProducers = 4;
+
+// Accepts one connection and counts newline-terminated frames
+class LoopbackListener {
+public:
+    LoopbackListener() {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        ::listen(listen_fd_, 1);
+
+        socklen_t length = sizeof(address);
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+        port_ = ntohs(address.sin_port);
+
+        thread_ = std::thread([this] {
+            const int fd = ::accept(listen_fd_, nullptr, nullptr);
+            std::vector<char> buffer(1 << 16);
+            for (;;) {
+                const ssize_t n = ::read(fd, buffer.data(), buffer.size());
+                if (n <= 0) break;
+                size_t lines = 0;
+                for (ssize_t i = 0; i < n; ++i) {
+                    lines += buffer[i] == '\n';
+                }
+                frames_.fetch_add(lines, std::memory_order_relaxed);
+            }
+            ::close(fd);
+        });
+    }
+
+    ~LoopbackListener() {
+        thread_.join();
+        ::close(listen_fd_);
+    }
+
+    uint16_t port() const { return port_; }
+    size_t frames() const { return frames_.load(std::memory_order_relaxed); }
+
+private:
+    int listen_fd_;
+    uint16_t port_{0};
+    std::atomic<size_t> frames_{0};
+    std::thread thread_;
+};
+
+int connect_loopback(uint16_t port) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+void produce(Category& category, size_t messages_per_producer) {
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (size_t i = 0; i < messages_per_producer; ++i) {
+                Debugger::instance().emit(category, Level::info, "request completed",
+                    field("producer", static_cast<int64_t>(p)),
+                    field("seq", static_cast<int64_t>(i)),
+                    field("url", "/api/users"));
+            }
+        });
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+}
+
+void wait_for(const LoopbackListener& listener, size_t frames) {
+    const auto deadline = Clock::now() + std::chrono::seconds(30);
+    while (listener.frames() < frames && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+void report(const char* name, size_t frames, double seconds, size_t writes) {
+    std::cout << std::setw(14) << name
+              << std::setw(12) << frames
+              << std::setw(12) << std::fixed << std::setprecision(3) << seconds
+              << std::setw(14) << std::setprecision(0) << frames / seconds
+              << std::setw(14) << std::setprecision(1) << static_cast<double>(frames) / writes << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t messages_per_producer = 50000;
+    if (argc > 1) {
+        messages_per_producer = std::stoul(argv[1]);
+    }
+    const size_t total = kProducers * messages_per_producer;
+
+    auto& dbg = Debugger::instance();
+    std::cout << "=== Socket Sink Benchmark (" << kProducers << " producers x "
+              << messages_per_producer << " messages, loopback) ===\n"
+              << std::setw(14) << "sink"
+              << std::setw(12) << "frames"
+              << std::setw(12) << "seconds"
+              << std::setw(14) << "msgs/s"
+              << std::setw(14) << "frames/write" << std::endl;
+
+    // Baseline: dump each message and send it on its own
+    {
+        LoopbackListener listener;
+        const int fd = connect_loopback(listener.port());
+        std::atomic<size_t> writes{0};
+        dbg.register_handler("bench.naive", [&](const json& message) {
+            json frame = {{"framework", "Debugger"}, {"command", "debug:message"}, {"payload", message}};
+            const std::string text = frame.dump() + "\n";
+            ::send(fd, text.data(), text.size(), MSG_NOSIGNAL);
+            writes.fetch_add(1, std::memory_order_relaxed);
+        });
+        dbg.init(1);
+
+        const auto start = Clock::now();
+        produce(dbg.intern_category("bench.naive"), messages_per_producer);
+        dbg.shutdown();
+        wait_for(listener, total);
+        report("per-message", listener.frames(), std::chrono::duration<double>(Clock::now() - start).count(),
+               std::max<size_t>(writes.load(), 1));
+        ::close(fd);
+    }
+
+    // SocketSink: one vectored write per pass over the queued batches
+    {
+        LoopbackListener listener;
+        SocketSinkOptions options;
+        options.port = listener.port();
+        options.max_queued_bytes = size_t{256} << 20;
+        auto sink = std::make_shared<SocketSink>(options);
+        auto subscriber = dbg.add_sink("bench.sink", sink);
+        dbg.init(1);
+
+        const auto start = Clock::now();
+        produce(dbg.intern_category("bench.sink"), messages_per_producer);
+        dbg.shutdown();
+        sink->flush();
+        wait_for(listener, total);
+        const auto stats = sink->stats();
+        report("SocketSink", listener.frames(), std::chrono::duration<double>(Clock::now() - start).count(),
+               std::max<uint64_t>(stats.writes, 1));
+        if (stats.frames_dropped != 0) {
+            std::cerr << "dropped " << stats.frames_dropped << " frames" << std::endl;
+        }
+        
+        // Detach so the sink closes its connection before the listener goes
+        subscriber->unsubscribe();
+        dbg.remove_subscriber(subscriber);
+        sink.reset();
+    }
+
+    return 0;
+}
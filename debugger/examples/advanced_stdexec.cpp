@@ -1,4 +1,5 @@
 #include <debugger/debugger.hpp>
+#include <debugger/trace_sink.hpp>
 #include <stdexec/execution.hpp>
 #include <exec/static_thread_pool.hpp>
 #include <iostream>
@@ -96,25 +97,31 @@ int main() {
     std::cout << "Task 3 result: " << r3 << std::endl;
     
     // Wait for debug messages to be processed
-    std::this_thread::sleep_for(200ms);
+    stdexec::sync_wait(Debugger::instance().flush());
     
     // Demonstrate using a subitem in an async context
     std::cout << "\n--- Async Subitem Example ---\n" << std::endl;
     
     auto subitem = Debugger::instance().create_subitem("AsyncWorker", "tasks");
     
+    // Spans time the work; open async_trace.json in ui.perfetto.dev
+    auto trace = std::make_shared<TraceSink>(TraceSinkOptions{.path = "async_trace.json"});
+    Debugger::instance().add_sink("tasks.**", trace);
+    
     auto async_work = stdexec::schedule(app_scheduler)
         | stdexec::then([subitem] {
-            subitem->log_info("Async work started");
-            std::this_thread::sleep_for(50ms);
-            subitem->log_info("Async work completed", {
-                {"duration_ms", 50}
-            });
+            auto work = subitem->span("Async work");
+            {
+                auto load = subitem->span("Load input");
+                std::this_thread::sleep_for(20ms);
+            }
+            auto compute = subitem->span("Compute");
+            std::this_thread::sleep_for(30ms);
         });
     
     stdexec::sync_wait(std::move(async_work));
-    
-    std::this_thread::sleep_for(100ms);
+    stdexec::sync_wait(Debugger::instance().flush());
+    std::cout << "Trace events written: " << trace->events_written() << std::endl;
     
     // Shutdown
     Debugger::instance().shutdown();
@@ -41,8 +41,8 @@ int main() {
         {"protocol", "HTTP/1.1"}
     );
     
-    // Wait a bit for messages to be processed
-    std::this_thread::sleep_for(100ms);
+    // Wait until the messages have been processed
+    stdexec::sync_wait(Debugger::instance().flush());
     
     std::cout << "\n=== Subscriber Example ===" << std::endl;
     
@@ -58,7 +58,7 @@ int main() {
         {"url", "/api/users"}
     });
     
-    std::this_thread::sleep_for(100ms);
+    stdexec::sync_wait(Debugger::instance().flush());
     
     // Shutdown the debugger
     Debugger::instance().shutdown();
@@ -89,9 +89,12 @@ class CacheModule {
 public:
     CacheModule() {
         subitem_ = Debugger::instance().create_subitem("CacheModule", "application");
+        hits_ = subitem_->counter("hits");
+        misses_ = subitem_->counter("misses");
     }
     
     void cache_hit(const std::string& key) {
+        hits_.increment();
         subitem_->log("Cache hit", {
             {"key", key},
             {"ttl_remaining", 300}
@@ -99,6 +102,7 @@ public:
     }
     
     void cache_miss(const std::string& key) {
+        misses_.increment();
         subitem_->log_warning("Cache miss", {
             {"key", key},
             {"will_fetch_from_db", true}
@@ -107,6 +111,9 @@ public:
 
 private:
     std::shared_ptr<DebugSubitem> subitem_;
+    // Summed in place and sent as one "metrics" record per interval
+    Counter hits_;
+    Counter misses_;
 };
 
 int main() {
@@ -125,7 +132,11 @@ int main() {
     });
     
     Debugger::instance().register_handler("application.CacheModule", [](const json& msg) {
-        std::cout << "[APP/CACHE] " << msg["message"] << std::endl;
+        std::cout << "[APP/CACHE] " << msg["message"];
+        if (msg["data"].contains("counters")) {
+            std::cout << " " << msg["data"]["counters"].dump();
+        }
+        std::cout << std::endl;
     });
     
     // Create module instances
@@ -149,7 +160,7 @@ int main() {
     network.handle_error("Connection timeout after 30 seconds");
     
     // Wait for all messages to be processed
-    std::this_thread::sleep_for(200ms);
+    stdexec::sync_wait(Debugger::instance().flush());
     
     // Display all registered subitems
     std::cout << "\n--- Registered Subitems ---" << std::endl;
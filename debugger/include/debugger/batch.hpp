@@ -0,0 +1,37 @@
+#pragma once
+
+#include <debugger/record.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+namespace debugger {
+
+// Describes one delivered batch
+struct BatchInfo {
+    size_t lane;                // Dispatch lane that delivered it
+    uint64_t first_timestamp;   // Timestamp of the first record
+    uint64_t last_timestamp;    // Timestamp of the last record
+    size_t bytes;               // Encoded size of all records
+};
+
+// When a batch is handed to its handler. A batch is delivered at the end of
+// each dispatch pass, unless max_linger asks to wait for more records, and
+// as soon as it reaches max_batch_size.
+struct BatchOptions {
+    size_t max_batch_size = 1024;
+    std::chrono::microseconds max_linger{0};
+};
+
+// Receives records in batches. The views are only valid during the call.
+using BatchHandler = std::function<void(std::span<const RecordView>, const BatchInfo&)>;
+
+// A batch handler together with its options, as routed by the debugger
+struct BatchSink {
+    BatchHandler handler;
+    BatchOptions options;
+};
+
+} // namespace debugger
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <debugger/id_table.hpp>
+#include <debugger/sampler.hpp>
+#include <debugger/throttle.hpp>
+
+namespace debugger {
+
+// What a producer does when the lane queue for a category is full
+enum class OverflowPolicy : uint8_t {
+    block,          // Wait for the dispatcher to make room
+    drop_newest,    // Discard the records being handed off
+    drop_oldest,    // Evict the oldest queued records to make room
+    sample          // Keep one in sample_every of the overflow, evicting the oldest for it
+};
+
+// An interned category name. Instances live as long as the registry that
+// created them, so callers may cache references to them.
+class Category {
+public:
+    Category(std::string name, uint32_t id)
+        : name_(std::move(name))
+        , id_(id) {}
+
+    Category(const Category&) = delete;
+    Category& operator=(const Category&) = delete;
+
+    const std::string& name() const { return name_; }
+    uint32_t id() const { return id_; }
+
+    // True while at least one handler or subscriber listens to this category,
+    // or a flight recorder keeps everything. This is the only check made
+    // before a message is built.
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+    // True while handlers or subscribers listen, so records must be queued
+    // for dispatch rather than only recorded
+    bool routed() const { return routed_.load(std::memory_order_relaxed); }
+    void set_routed(bool routed) { routed_.store(routed, std::memory_order_relaxed); }
+
+    // Overflow policy for this category, or nullopt to use the debugger's
+    std::optional<OverflowPolicy> overflow_policy() const {
+        const auto value = policy_.load(std::memory_order_relaxed);
+        return value == inherit_policy ? std::nullopt : std::optional(static_cast<OverflowPolicy>(value));
+    }
+    void set_overflow_policy(std::optional<OverflowPolicy> policy) {
+        policy_.store(policy ? static_cast<uint8_t>(*policy) : inherit_policy, std::memory_order_relaxed);
+    }
+
+    // Exact number of records lost to overflow: discarded before queueing,
+    // or evicted from the queue by newer records
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t overwritten() const { return overwritten_.load(std::memory_order_relaxed); }
+
+    // Loss accounting, updated by whichever producer hits the overflow.
+    // Unreported losses are handed to the next record staged for the category.
+    void count_dropped(uint64_t count) const {
+        dropped_.fetch_add(count, std::memory_order_relaxed);
+        unreported_.fetch_add(count, std::memory_order_relaxed);
+    }
+    void count_overwritten(uint64_t count) const {
+        overwritten_.fetch_add(count, std::memory_order_relaxed);
+        unreported_.fetch_add(count, std::memory_order_relaxed);
+    }
+    void defer_report(uint64_t count) const { unreported_.fetch_add(count, std::memory_order_relaxed); }
+    bool has_unreported() const { return unreported_.load(std::memory_order_relaxed) != 0; }
+    uint64_t take_unreported() const { return unreported_.exchange(0, std::memory_order_relaxed); }
+
+    // Sampling, or null (see Debugger::set_sampling)
+    Sampler* sampler() const { return sampler_.load(std::memory_order_acquire); }
+    void set_sampler(Sampler* sampler) { sampler_.store(sampler, std::memory_order_release); }
+
+    // Rate limit and repeat collapsing, or null (see Debugger::set_throttle)
+    Throttle* throttle() const { return throttle_.load(std::memory_order_acquire); }
+    void set_throttle(Throttle* throttle) { throttle_.store(throttle, std::memory_order_release); }
+
+    // Running count of overflowing records, used to pick samples
+    uint64_t next_overflow() const { return overflow_seen_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    static constexpr uint8_t inherit_policy = 0xff;
+
+    std::string name_;
+    uint32_t id_;
+    std::atomic<bool> enabled_{false};
+    std::atomic<bool> routed_{false};
+    std::atomic<uint8_t> policy_{inherit_policy};
+    std::atomic<Sampler*> sampler_{nullptr};
+    std::atomic<Throttle*> throttle_{nullptr};
+    mutable std::atomic<uint64_t> dropped_{0};
+    mutable std::atomic<uint64_t> overwritten_{0};
+    mutable std::atomic<uint64_t> unreported_{0};
+    mutable std::atomic<uint64_t> overflow_seen_{0};
+};
+
+// Maps category names to stable Category objects with dense ids.
+// intern() and find() must be serialised by the owner; get() is lock-free
+// and safe to call from any thread.
+class CategoryRegistry {
+public:
+    // Return the category for name, creating it if needed.
+    // The bool is true when the category was created by this call.
+    std::pair<Category&, bool> intern(std::string_view name) {
+        if (auto* category = find(name)) {
+            return {*category, false};
+        }
+        auto& category = categories_.emplace_back(std::string(name), static_cast<uint32_t>(categories_.size()));
+        by_name_.emplace(category.name(), &category);
+        by_id_.set(category.id(), &category);
+        return {category, true};
+    }
+
+    Category* get(uint32_t id) const {
+        return by_id_.get(id);
+    }
+
+    Category* find(std::string_view name) const {
+        auto it = by_name_.find(name);
+        return it != by_name_.end() ? it->second : nullptr;
+    }
+
+    template<typename Fn>
+    void for_each(Fn&& fn) {
+        for (auto& category : categories_) {
+            fn(category);
+        }
+    }
+
+    template<typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& category : categories_) {
+            fn(category);
+        }
+    }
+
+    size_t size() const { return categories_.size(); }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    std::deque<Category> categories_;
+    std::unordered_map<std::string_view, Category*, Hash, std::equal_to<>> by_name_;
+    IdTable<Category> by_id_;
+};
+
+} // namespace debugger
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(DEBUGGER_NO_TSC)
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+#  define DEBUGGER_HAS_TSC 1
+#else
+#  define DEBUGGER_HAS_TSC 0
+#endif
+
+namespace debugger {
+
+// Source of record timestamps: nanoseconds since the Unix epoch, monotonic,
+// and much cheaper than system_clock. Until calibrate() is called, and
+// wherever the CPU has no invariant timestamp counter, it is steady_clock
+// plus a fixed offset. Once calibrated it reads the counter directly,
+// scaled by a rate measured against steady_clock, which recalibrate() keeps
+// in step with steady_clock from then on. Either way it is pinned to
+// system_clock once, so it drifts from wall time by whatever the system
+// clock is later adjusted by.
+class RecordClock {
+public:
+    static uint64_t now() {
+        const Calibration& c = calibration();
+        for (;;) {
+            const uint32_t version = c.version.load(std::memory_order_acquire);
+            const bool tsc = c.tsc.load(std::memory_order_relaxed);
+            const uint64_t base_ticks = c.base_ticks.load(std::memory_order_relaxed);
+            const uint64_t base_ns = c.base_ns.load(std::memory_order_relaxed);
+            const double ns_per_tick = c.ns_per_tick.load(std::memory_order_relaxed);
+            const uint64_t ticks = read_ticks(tsc);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((version & 1) != 0 || c.version.load(std::memory_order_relaxed) != version) continue;
+
+            // A core whose counter is slightly behind the one that took
+            // base_ticks reads the base rather than wrapping around
+            const uint64_t elapsed = ticks > base_ticks ? ticks - base_ticks : 0;
+            if (!tsc) return base_ns + elapsed;
+            return base_ns + static_cast<uint64_t>(static_cast<double>(elapsed) * ns_per_tick);
+        }
+    }
+
+    // Measures the counter's rate, taking about 5 ms the first time and
+    // nothing after that. Debugger::init calls it.
+    static void calibrate();
+
+    // Corrects the counter's rate from its run against steady_clock since
+    // calibrate(), and slews out whatever the clock has drifted by since the
+    // last call over the same period again. Does not block; lane 0 calls it
+    // about once a second.
+    static void recalibrate();
+
+    // True if now() reads the timestamp counter
+    static bool uses_tsc() { return calibration().tsc.load(std::memory_order_relaxed); }
+
+    // Counter ticks per nanosecond as calibrated; 1 for steady_clock
+    static double ticks_per_ns() { return 1.0 / calibration().ns_per_tick.load(std::memory_order_relaxed); }
+
+private:
+    // Written by one thread at a time under a seqlock, so now() always
+    // reads a consistent set
+    struct Calibration {
+        Calibration();
+
+        std::atomic<uint32_t> version{0};       // Odd while being written
+        std::atomic<bool> tsc{false};
+        std::atomic<uint64_t> base_ticks{0};    // Counter (or steady_clock) reading at base_ns
+        std::atomic<uint64_t> base_ns{0};
+        std::atomic<double> ns_per_tick{1.0};
+    };
+
+    static Calibration& calibration() {
+        static Calibration c;
+        return c;
+    }
+
+    static uint64_t read_ticks(bool tsc) {
+#if DEBUGGER_HAS_TSC
+        if (tsc) return __rdtsc();
+#else
+        (void)tsc;
+#endif
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static void publish(Calibration& c, uint64_t base_ticks, uint64_t base_ns, double ns_per_tick);
+};
+
+} // namespace debugger
@@ -7,48 +7,177 @@
 #include <unordered_map>
 #include <functional>
 #include <nlohmann/json.hpp>
+#include <debugger/batch.hpp>
+#include <debugger/category.hpp>
+#include <debugger/clock.hpp>
+#include <debugger/flight_recorder.hpp>
+#include <debugger/id_table.hpp>
+#include <debugger/level.hpp>
+#include <debugger/message.hpp>
+#include <debugger/metrics.hpp>
+#include <debugger/record.hpp>
+#include <debugger/senders.hpp>
+#include <debugger/sink.hpp>
+#include <debugger/span.hpp>
+#include <debugger/stats.hpp>
+#include <debugger/subscriber.hpp>
+#include <debugger/ring_buffer.hpp>
+#include <debugger/topic_trie.hpp>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <optional>
 #include <vector>
 
 namespace debugger {
 
 using json = nlohmann::json;
 
-class DebugMessage;
-class DebugSubscriber;
-
 // Subitem represents a debuggable component or module in your application
 class DebugSubitem {
 public:
-    DebugSubitem(std::string name, std::string parent_category = "")
-        : name_(std::move(name))
-        , parent_category_(std::move(parent_category))
-        , id_(generate_id()) {}
+    DebugSubitem(std::string name, std::string parent_category = "");
 
     const std::string& name() const { return name_; }
     const std::string& parent_category() const { return parent_category_; }
     const std::string& id() const { return id_; }
 
-    void log(const std::string& message, const json& data = {});
-    void log_error(const std::string& message, const json& data = {});
-    void log_warning(const std::string& message, const json& data = {});
-    void log_info(const std::string& message, const json& data = {});
+    // Dense index carried in RecordHeader::subitem (never 0)
+    uint64_t index() const { return index_; }
+
+    // Interned category, resolved once at construction
+    const Category& category() const { return *category_; }
+
+    // True if anything listens to this subitem's category
+    bool enabled() const { return category_->enabled(); }
+
+    void log(const std::string& message, const json& data = {}) {
+        if constexpr (level_enabled(Level::debug)) log_at(Level::debug, message, data);
+    }
+    void log_error(const std::string& message, const json& data = {}) {
+        if constexpr (level_enabled(Level::error)) log_at(Level::error, message, data);
+    }
+    void log_warning(const std::string& message, const json& data = {}) {
+        if constexpr (level_enabled(Level::warning)) log_at(Level::warning, message, data);
+    }
+    void log_info(const std::string& message, const json& data = {}) {
+        if constexpr (level_enabled(Level::info)) log_at(Level::info, message, data);
+    }
+
+    // Log at a runtime-selected level
+    void log_at(Level level, const std::string& message, const json& data = {});
+
+    // Log with data built by make_data() only if the record gets past this
+    // subitem's throttle; DEBUG_SUBITEM_LOG uses it
+    template<typename MakeData>
+    void log_lazy(Level level, std::string_view message, MakeData&& make_data);
+
+    // Rate limit or collapse repeats of this subitem's category
+    void set_throttle(const ThrottleOptions& options);
+
+    // Sample this subitem's category
+    void set_sampling(const SamplingOptions& options);
+
+    // Time a scope; the span is recorded when it goes out of scope or on
+    // Span::end, as one record flagged record_span
+    Span span(std::string_view name) const { return Span(*this, name); }
+
+    // Metrics of this subitem, aggregated in place of a record per update
+    // and sent as one summary record (flagged record_metrics) every
+    // DebuggerOptions::metrics_interval. Asking for the same name again
+    // returns the same metric; a name already taken by another kind gets
+    // a handle that ignores updates. Look metrics up once and keep them:
+    //   auto processed = subitem->counter("items_processed");
+    //   processed.increment();
+    Counter counter(std::string_view name) const;
+    Gauge gauge(std::string_view name) const;
+    Histogram histogram(std::string_view name) const;
+
+    // Log typed fields without building json:
+    //   subitem->emit(Level::info, "Query completed", field("rows", 15), field("query", sql));
+    // Scalars and strings are copied straight into the queued record.
+    template<typename... Ts>
+    void emit(Level level, std::string_view message, const FieldArg<Ts>&... fields);
 
 private:
+    friend class Span;
+
     static std::string generate_id();
+    void record_span(const Span& span, uint64_t end) const;
+
     std::string name_;
     std::string parent_category_;
     std::string id_;
+    Category* category_;
+    uint64_t index_;
+};
+
+// Runtime configuration accepted by Debugger::init
+struct DebuggerOptions {
+    // Dispatch lanes, one per worker thread. Categories are spread across
+    // lanes by id, so each category is still delivered in order.
+    size_t num_threads = 1;
+    // Maximum number of queued messages per lane; rounded up to a power of two
+    size_t queue_capacity = 1 << 16;
+    // Messages a thread buffers locally before handing them over as one batch
+    size_t staging_capacity = 256;
+    // Oldest a partially filled staging buffer may get before it is flushed
+    std::chrono::microseconds staging_max_age{1000};
+    // What producers do when a lane's queue is full, unless the category
+    // overrides it with Debugger::set_overflow_policy
+    OverflowPolicy overflow_policy = OverflowPolicy::block;
+    // With OverflowPolicy::sample, one overflowing record in this many is kept
+    uint32_t sample_every = 16;
+    // Queue each level separately on every lane, so an error is not stuck
+    // behind a flood of debug records. Off by default, since it gives up
+    // per-category order: a category's error may then reach handlers and
+    // sinks before its earlier debug and info records (RecordView::sequence
+    // still tells the order they were logged in). Order within a level is
+    // kept either way.
+    bool priority_lanes = false;
+    // Share of a busy lane each level gets while others have records
+    // waiting too, indexed by Level
+    std::array<uint32_t, level_count> level_weights{1, 2, 4, 8};
+    // Errors are staged for at most this long before they are handed
+    // over, and then taken between any two records of another level while
+    // within their share, and beyond it once they have waited this long
+    std::chrono::microseconds error_latency{100};
+    // Keep the counters behind Debugger::stats(). Costs a clock read per
+    // dispatched record.
+    bool collect_stats = true;
+    // Publish stats() as json on stats_category this often while something
+    // listens to it; zero turns publishing off
+    std::chrono::milliseconds stats_interval{0};
+    // Send each subitem's metrics summary this often, if any of its metrics
+    // changed; zero sends them only at shutdown
+    std::chrono::milliseconds metrics_interval{1000};
+};
+
+// Records lost to queue overflow, summed over all categories
+struct LossStats {
+    uint64_t dropped{0};
+    uint64_t overwritten{0};
 };
 
 class Debugger {
 public:
     using MessageHandler = std::function<void(const json&)>;
+    using RecordHandler = std::function<void(const RecordView&)>;
     using SubscriberMap = std::unordered_map<std::string, std::shared_ptr<DebugSubscriber>>;
     using SubitemMap = std::unordered_map<std::string, std::shared_ptr<DebugSubitem>>;
+    using Options = DebuggerOptions;
+
+    // Name, id string and category for a subitem index, kept for the
+    // debugger's lifetime
+    struct SubitemInfo {
+        std::string id;
+        std::string name;
+        uint32_t category;
+    };
 
     static Debugger& instance() {
         static Debugger instance;
@@ -62,9 +191,13 @@ public:
     // Initialize the debugger with default thread pool
     void init(size_t num_threads = 1);
 
-    // Initialize the debugger with a custom scheduler
+    // Initialize the debugger with explicit options
+    void init(const Options& options);
+
+    // Initialize the debugger with a custom scheduler. Each of the
+    // options.num_threads lanes occupies one of the scheduler's threads
     template<typename Scheduler>
-    void init_with_scheduler(Scheduler scheduler);
+    void init_with_scheduler(Scheduler scheduler, const Options& options = {});
 
     // Shutdown the debugger
     void shutdown();
@@ -75,15 +208,130 @@ public:
     // Send a debug message
     void send_message(const std::string& category, const std::string& message, const json& data = {});
 
+    // Send a debug message to an already interned category
+    void send_message(const Category& category, const std::string& message, const json& data = {});
+
+    // Send a message whose data is built by make_data() only if the record
+    // gets past the category's throttle; DEBUG_LOG uses it
+    template<typename MakeData>
+    void send_lazy(const Category& category, Level level, std::string_view message, MakeData&& make_data);
+
+    // Send typed fields to an interned category without building json
+    template<typename... Ts>
+    void emit(const Category& category, Level level, std::string_view message, const FieldArg<Ts>&... fields);
+
+    // Sender that completes once every record staged or queued before it
+    // starts has been delivered to handlers and sinks (see senders.hpp):
+    //   stdexec::sync_wait(Debugger::instance().flush());
+    // Records a throttle is still holding back, and whatever a sink buffers
+    // itself (see Sink::flush), are not covered.
+    FlushSender flush() const { return FlushSender(NoRecords{}); }
+
+    // Same, for the records of one category
+    FlushSender flush(const Category& category) const { return FlushSender(NoRecords{&category}); }
+
+    // Sender that sends a message when started and completes once it has
+    // been delivered
+    auto send_async(const Category& category, std::string message, json data = {}) {
+        return DeliverySender([this, &category, message = std::move(message), data = std::move(data)] {
+            send_message(category, message, data);
+            return &category;
+        });
+    }
+
+    auto send_async(std::string category, std::string message, json data = {}) {
+        return DeliverySender([this, category = std::move(category), message = std::move(message),
+                               data = std::move(data)]() -> const Category* {
+            Category& target = resolve_category(category);
+            send_message(target, message, data);
+            return &target;
+        });
+    }
+
+    // Sender that sends a batch of messages when started and completes once
+    // all of them have been delivered
+    auto send_batch_async(std::vector<DebugMessage> messages) {
+        return DeliverySender([this, messages = std::move(messages)]() -> const Category* {
+            for (const auto& message : messages) {
+                send_message(message.category(), message.message(), message.data());
+            }
+            return nullptr;
+        });
+    }
+
+    // Look up or create the category object for a name. The returned
+    // reference stays valid for the lifetime of the debugger.
+    Category& intern_category(std::string_view name);
+
+    // Look up an interned category by id (lock-free)
+    const Category* category(uint32_t id) const { return categories_.get(id); }
+
+    // Look up a subitem by the index records carry (lock-free)
+    const SubitemInfo* subitem_info(uint64_t index) const { return subitem_table_.get(index); }
+
+    // Override Options::overflow_policy for one category. Records already
+    // staged keep the policy they were staged with.
+    void set_overflow_policy(std::string_view category, OverflowPolicy policy);
+
+    // Rate limit a category and/or collapse its repeated messages (see
+    // throttle.hpp). Decided by the producer before anything is encoded or
+    // queued; held-back records are reported by summary records. Options
+    // that limit nothing remove the throttle.
+    void set_throttle(std::string_view category, const ThrottleOptions& options);
+
+    // Keep only a sample of a category's records (see sampler.hpp). Decided
+    // by the producer before anything is encoded or queued; kept records
+    // carry their sample weight. SamplingMode::none removes the sampler.
+    void set_sampling(std::string_view category, const SamplingOptions& options);
+
+    // Keep the most recent records of every category in a memory-mapped file
+    // that survives a crash (see flight_recorder.hpp). Producers copy each
+    // record in as they send it, so records still staged or queued when the
+    // process dies are kept, and categories without listeners are recorded
+    // too. Stays on for the debugger's lifetime. Returns false if the file
+    // could not be created or a recorder is already on.
+    bool enable_flight_recorder(const FlightRecorderOptions& options);
+
+    // Exact totals of records lost to overflow. Per-category counts are on
+    // Category::dropped() and Category::overwritten().
+    LossStats loss_stats() const;
+
+    // Queue depths, enqueue and dispatch latency, per-category handler time
+    // and per-category and per-subitem traffic, summed on demand from
+    // per-thread and per-lane counters
+    DebuggerStats stats() const;
+
+    // Build the json message handlers receive from an encoded record
+    json to_json(const RecordView& record) const;
+
     // Register a message handler for a specific category
     void register_handler(const std::string& category, MessageHandler handler);
 
-    // Create a subscriber for a specific category
-    std::shared_ptr<DebugSubscriber> create_subscriber(const std::string& category);
+    // Register a handler that receives the encoded record; no json is built
+    // for it
+    void register_record_handler(const std::string& category, RecordHandler handler);
 
-    // Get a subscriber by name
+    // Register a handler that receives the category's records in batches,
+    // for sinks that pay per call (a write, a flush, a socket send)
+    void register_batch_handler(const std::string& category, BatchHandler handler, BatchOptions options = {});
+
+    // Create a subscriber for a category or pattern. Patterns match dotted
+    // segments: "application.*" covers one level below application and
+    // "application.**" any depth. Every call creates a new, independent
+    // subscriber; all subscribers matching a category receive its messages.
+    std::shared_ptr<DebugSubscriber> create_subscriber(const std::string& pattern);
+
+    // Get the first subscriber created for exactly this pattern
     std::shared_ptr<DebugSubscriber> get_subscriber(const std::string& name);
 
+    // Detach a subscriber created by create_subscriber
+    void remove_subscriber(const std::shared_ptr<DebugSubscriber>& subscriber);
+
+    // Send batches of every category matching pattern to a sink. The
+    // returned subscriber detaches it again through remove_subscriber.
+    std::shared_ptr<DebugSubscriber> add_sink(const std::string& pattern, std::shared_ptr<Sink> sink,
+                                              BatchOptions options = {});
+
     // Create a debug subitem for component-level debugging
     std::shared_ptr<DebugSubitem> create_subitem(const std::string& name, const std::string& parent_category = "");
 
@@ -97,59 +345,502 @@ private:
     Debugger() = default;
     ~Debugger();
 
-    struct Message {
-        std::string category;
-        json data;
-        std::chrono::system_clock::time_point timestamp;
+    friend class DebugSubitem;
+    friend class Counter;
+    friend class Histogram;
+    friend void request_flush(FlushWaiter& waiter, const Category* category);
+
+    // Encoded records handed from one producer thread to the dispatcher in one go
+    struct Batch {
+        std::vector<std::byte> bytes;
+        size_t count{0};
+    };
+
+    using SubscriberList = std::vector<std::shared_ptr<const DebugSubscriber::Callback>>;
+    using BatchSinkList = std::vector<std::shared_ptr<const BatchSink>>;
+
+    // Everything registered for one category. Callbacks are shared so
+    // copying a route into a new snapshot is cheap. The subscriber lists are
+    // the category's resolved fan-out, in subscription order, so dispatch
+    // never consults the patterns.
+    struct Route {
+        std::shared_ptr<const MessageHandler> handler;
+        std::shared_ptr<const RecordHandler> record_handler;
+        std::shared_ptr<const BatchSink> batch_handler;
+        SubscriberList subscribers;
+        BatchSinkList batch_subscribers;
+
+        bool empty() const {
+            return !handler && !record_handler && !batch_handler
+                && subscribers.empty() && batch_subscribers.empty();
+        }
+    };
+
+    // Immutable routing snapshot indexed by category id. Categories past the
+    // end have no routes. Writers copy, modify and publish a new table.
+    using RouteTable = std::vector<Route>;
+
+    // A subscriber and its position in subscription order
+    struct Subscription {
+        uint64_t order;
+        std::shared_ptr<DebugSubscriber> subscriber;
     };
 
-    void process_messages();
-    void process_message(const Message& msg);
-    void start_processing_loop();
+    // A thread's partially filled batch for one lane
+    struct Stage {
+        Batch* batch{nullptr};
+        std::chrono::steady_clock::time_point opened;
+        bool fresh{false};
+    };
+
+    // Per-thread buffer holding one Stage per lane; the mutex is only
+    // contended when a dispatcher sweeps stale batches. The counters are
+    // written under the mutex and read by stats() without it.
+    struct StagingBuffer {
+        std::mutex mutex;
+        std::vector<Stage> stages;
+        CounterArray messages;          // By category id
+        CounterArray subitem_messages;  // By subitem index
+        CounterArray metrics;           // By metric slot, written without the mutex
+        HistogramCounter enqueue_wait;
+    };
+
+    // One metric of a subitem. Counters take one slot of the per-thread
+    // metric counters and histograms one per bucket after their sum; gauges
+    // keep their value here. reported holds the totals last sent.
+    struct MetricInfo {
+        std::string name;
+        MetricKind kind;
+        uint32_t slot{0};
+        std::atomic<double> gauge{0};
+        std::vector<uint64_t> reported;
+        std::optional<double> reported_gauge;
+    };
+
+    // A subitem's metrics, sent together
+    struct MetricGroup {
+        const Category* category{nullptr};
+        std::deque<MetricInfo> metrics;
+        uint64_t reported_at{0};
+    };
+
+    // Records collected on a lane for one batch sink
+    struct PendingBatch {
+        std::shared_ptr<const BatchSink> sink;
+        std::vector<std::byte> bytes;
+        size_t count{0};
+        std::chrono::steady_clock::time_point opened;
+    };
+
+    // Map nodes are kept for reuse once delivered, so a lane settles on a
+    // fixed set of buffers and never allocates for them again
+    using PendingBatches = std::unordered_map<const BatchSink*, PendingBatch>;
+    using PendingNode = PendingBatches::node_type;
+
+    // Staging slots per lane, one for each level and overflow policy, so
+    // every batch is handed off to a single level's queues under a single
+    // policy
+    static constexpr size_t policy_count = 4;
+    static constexpr size_t slots_per_lane = level_count * policy_count;
+    static constexpr size_t error_queue = static_cast<size_t>(Level::error);
+
+    // Only used with priority lanes on; otherwise every level stages in
+    // the first level's slots
+    static constexpr bool error_slot(size_t slot) { return slot / policy_count % level_count == error_queue; }
+
+    // A level's queues on one lane. Batches that may be evicted
+    // (drop_oldest, sample) get their own ring so eviction never touches
+    // blocking traffic.
+    struct LevelQueues {
+        std::unique_ptr<MpmcRing<Batch*>> queue;
+        std::unique_ptr<MpmcRing<Batch*>> overwrite_queue;
+
+        bool empty() const { return queue->empty() && overwrite_queue->empty(); }
+        bool try_pop(Batch*& batch) { return queue->try_pop(batch) || overwrite_queue->try_pop(batch); }
+    };
+
+    // One dispatch shard: its own queues, wakeup state and processing loop.
+    // Producers only touch wake_mutex once the lane has announced it is idle
+    struct Lane {
+        // By level; only the first is used without priority lanes
+        std::array<LevelQueues, level_count> levels;
+        std::mutex wake_mutex;
+        std::condition_variable cv;
+        std::atomic<bool> idle{false};
+        // Set once the loop has made its last pass; whatever reaches the
+        // rings after that is counted as dropped by whoever pushed it
+        std::atomic<bool> exited{false};
+        std::atomic<size_t> staged_batches{0};
+        // Of those, the ones holding errors, which are swept once they are
+        // error_latency old rather than staging_max_age
+        std::atomic<size_t> staged_errors{0};
+        
+        // Flush points waiting for this lane, guarded by wake_mutex;
+        // flush_requested lets the loop look for them without the lock
+        std::vector<FlushWaiter*> flush_waiters;
+        std::atomic<bool> flush_requested{false};
+        bool accepting_flushes{false};
+        std::chrono::steady_clock::time_point last_sweep;
+        std::chrono::steady_clock::time_point last_error_sweep;
+
+        // Route table this lane is reading, published so writers know not
+        // to free it. The other two are only touched by the lane's thread.
+        std::atomic<const RouteTable*> hazard{nullptr};
+        const RouteTable* routes_in_use{nullptr};
+        size_t route_depth{0};
+
+        // Batches being collected for batch sinks, and delivered ones to
+        // reuse; only touched by the lane's thread
+        size_t index{0};
+        PendingBatches pending_batches;
+        std::vector<PendingNode> spare_batches;
+        
+        // Scratch space reused by every pass, so a lane in steady state
+        // allocates nothing; only touched by the lane's thread. A handler
+        // that logs can re-enter delivery, and then falls back to its own.
+        std::vector<PendingNode> due_batches;
+        std::vector<RecordView> record_views;
+        bool delivering{false};
+        std::vector<std::shared_ptr<StagingBuffer>> sweep_buffers;
+        // Set while sweep_buffers is walked. A blocking hand-off drains the
+        // lane, which may sweep errors again; that nested sweep is skipped
+        bool sweeping{false};
+        std::vector<FlushWaiter*> completing_flushes;
+        
+        // Batches this lane has finished with, returned to the shared pool
+        // together after each pass
+        std::vector<Batch*> free_batches;
+        
+        // Weighted scheduling: records each level may still dispatch this
+        // round, when errors beyond their share started waiting, and
+        // whether errors are being taken in the middle of another batch.
+        // Only touched by the lane's thread.
+        std::array<int64_t, level_count> credit{};
+        std::chrono::steady_clock::time_point errors_waiting;
+        bool taking_errors{false};
+        
+        // Stats. Producers raise queued_records and the lane lowers it (it
+        // may dip below zero briefly); the rest is written by the lane's
+        // thread only
+        std::atomic<int64_t> queued_records{0};
+        std::atomic<int64_t> high_water{0};
+        std::atomic<uint64_t> dispatched{0};
+        HistogramCounter dispatch_lag;
+        HistogramCounter error_lag;
+        HistogramCounter batch_time;
+        IdTable<HistogramCounter> handler_time;
+        std::deque<HistogramCounter> handler_time_storage;
+    };
+
+    Category& resolve_category(const std::string& name);
+    Category& intern_locked(std::string_view name);
+    template<typename Fn>
+    void update_route(Category& category, Fn&& modify);
+    std::unique_ptr<RouteTable> copy_routes() const;
+    void publish_routes(std::unique_ptr<RouteTable> table);
+    void resolve_subscribers(const Category& category, Route& route) const;
+    void refresh_subscribers(std::string_view pattern);
+    void set_routed(Category& category, bool routed);
+    void reclaim_routes();
+    const RouteTable& acquire_routes(Lane& lane);
+    void release_routes(Lane& lane);
+    uint64_t register_subitem(const std::string& id, const std::string& name, uint32_t category);
+
+    template<typename Encode>
+    void stage_record(const Category& category, Level level, uint64_t subitem,
+                      std::string_view message, Encode&& encode);
+    template<typename Encode>
+    void write_record(const Category& category, Level level, uint64_t subitem,
+                      std::string_view message, uint64_t timestamp, float sample_weight, Encode&& encode);
+    bool admit(Throttle& throttle, const Category& category, Level level, uint64_t subitem,
+               std::string_view message, uint64_t timestamp);
+    void send_throttle_report(const Category& category, const ThrottleReport& report, uint64_t timestamp);
+    std::chrono::steady_clock::time_point flush_throttles(bool force);
+    Stage& open_record(StagingBuffer& buffer, size_t slot);
+    void close_record(StagingBuffer& buffer, size_t slot);
+    void stage_loss_report(Stage& stage, const Category& category, uint64_t timestamp);
+
+    void prepare_lanes(const Options& options);
+    void start_lanes(auto scheduler);
+    size_t lane_for(uint32_t category) const;
+    size_t slot_for(const Category& category, Level level) const;
+    void run_lane(size_t index);
+    void drain_lane(Lane& lane);
+    void take_errors(Lane& lane);
+    void sweep_errors(Lane& lane, std::chrono::steady_clock::time_point now);
+    static bool lane_empty(const Lane& lane);
+    void process_batch(Lane& lane, Batch* batch, bool yields_to_errors = false);
+    void process_record(Lane& lane, const RouteTable& routes, const RecordView& record);
+    void collect_record(Lane& lane, const std::shared_ptr<const BatchSink>& sink, const RecordView& record);
+    void flush_batches(Lane& lane, bool force);
+    void deliver_batch(Lane& lane, PendingBatch& batch);
+    void wake_lane(Lane& lane);
+    void request_flush(FlushWaiter& waiter, const Category* category);
+    void complete_flushes(Lane& lane, bool closing);
+    void wake_all_lanes();
+
+    StagingBuffer& local_staging_buffer();
+    void hand_off(StagingBuffer& buffer, size_t slot);
+    std::chrono::nanoseconds push_blocking(MpmcRing<Batch*>& queue, size_t lane, Batch* batch);
+    void push_overwriting(Lane& lane, MpmcRing<Batch*>& queue, OverflowPolicy policy, Batch* batch);
+    void count_queued(Lane& lane, int64_t records);
+    HistogramCounter& handler_time(Lane& lane, uint32_t category);
+    void publish_stats();
+    MetricInfo* register_metric(const DebugSubitem& subitem, MetricKind kind, std::string_view name);
+    void publish_metrics();
+    void thin_batch(Batch& batch);
+    void discard_batch(Batch* batch, bool overwritten);
+    void discard_stranded(Lane& lane);
+    void sweep_staging_buffers(size_t lane, bool force, bool errors_only = false);
+    void retire_staging_buffer(const std::shared_ptr<StagingBuffer>& buffer);
+    Batch* acquire_batch();
+    void recycle_batch(Batch* batch);
+    void release_batches(Lane& lane);
 
     mutable std::mutex mutex_;
-    std::condition_variable cv_;
-    std::queue<Message> message_queue_;
-    std::unordered_map<std::string, MessageHandler> handlers_;
-    SubscriberMap subscribers_;
+
+    // Lanes are only added while stopped and never freed, so producers racing
+    // a shutdown never touch a destroyed queue
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    size_t num_lanes_{0};
+    std::atomic<size_t> active_loops_{0};
+
+    // Staging buffers of every thread that has sent a message, plus the pool
+    // of empty batches they draw from
+    mutable std::mutex staging_mutex_;
+    std::vector<std::shared_ptr<StagingBuffer>> staging_buffers_;
+    std::vector<std::unique_ptr<Batch>> batch_storage_;
+    std::vector<Batch*> free_batches_;
+    size_t staging_capacity_{1};
+    std::chrono::steady_clock::duration staging_max_age_{};
+    OverflowPolicy overflow_policy_{OverflowPolicy::block};
+    uint32_t sample_every_{1};
+    
+    // Priority lanes: records per round for each level, in batches' worth
+    bool priority_lanes_{false};
+    std::array<int64_t, level_count> level_shares_{};
+    std::chrono::steady_clock::duration error_latency_{};
+    
+    // Counters of staging buffers whose threads have exited, guarded by
+    // staging_mutex_
+    std::vector<uint64_t> retired_messages_;
+    std::vector<uint64_t> retired_subitem_messages_;
+    LatencyHistogram retired_enqueue_wait_;
+    
+    // Stats publishing, done by lane 0
+    bool collect_stats_{true};
+    std::chrono::steady_clock::duration stats_interval_{};
+    Category* stats_category_{nullptr};
+    std::chrono::steady_clock::time_point next_stats_;
+    std::optional<DebuggerStats> published_stats_;
+    
+    // Metrics by subitem index, guarded by metrics_mutex_, which also keeps
+    // summaries from lane 0 and shutdown apart. Never freed, since handles
+    // point into them. Lane 0 publishes them while has_metrics_ is set.
+    std::mutex metrics_mutex_;
+    std::map<uint64_t, MetricGroup> metric_groups_;
+    uint32_t next_metric_slot_{1};
+    std::vector<uint64_t> retired_metrics_;     // Guarded by staging_mutex_
+    std::atomic<bool> has_metrics_{false};
+    std::chrono::steady_clock::duration metrics_interval_{};
+    std::chrono::steady_clock::time_point next_metrics_;
+    
+    // RecordClock recalibration, done by lane 0
+    std::chrono::steady_clock::time_point next_recalibration_;
+
+    CategoryRegistry categories_;
+    std::deque<SubitemInfo> subitem_info_;
+    IdTable<SubitemInfo> subitem_table_;
+    TopicTrie<Subscription> subscriptions_;
+    uint64_t next_subscription_{0};
+
+    // Current route snapshot, read by the lanes without locking. Replaced
+    // tables wait in retired_routes_ until no lane's hazard points at them.
+    // Both owners are guarded by mutex_.
+    std::atomic<const RouteTable*> routes_{nullptr};
+    std::unique_ptr<const RouteTable> current_routes_;
+    std::vector<std::unique_ptr<const RouteTable>> retired_routes_;
+
+    // Throttles by category id, guarded by mutex_ and never freed, since
+    // producers use them without locking. Lane 0 flushes their stale reports.
+    std::unordered_map<uint32_t, std::unique_ptr<Throttle>> throttles_;
+    // Samplers ever installed, guarded by mutex_ and kept for the same reason
+    std::vector<std::unique_ptr<Sampler>> samplers_;
+    std::atomic<bool> has_throttles_{false};
+    std::chrono::steady_clock::time_point throttle_deadline_;
+    
+    // Written by producers without locking once published; never replaced
+    std::atomic<FlightRecorder*> flight_recorder_{nullptr};
+    std::unique_ptr<FlightRecorder> owned_flight_recorder_;
     SubitemMap subitems_;
     std::atomic<bool> running_{false};
+    // Next record sequence number; on its own cache line, since every
+    // producer thread takes one per record
+    alignas(64) std::atomic<uint64_t> next_sequence_{1};
     stdexec::in_place_stop_source stop_source_;
     std::unique_ptr<exec::static_thread_pool> thread_pool_;
     bool owns_thread_pool_{false};
 };
 
 // Template implementation
+template<typename... Ts>
+void DebugSubitem::emit(Level level, std::string_view message, const FieldArg<Ts>&... fields) {
+    if (!category_->enabled()) return;
+    Debugger::instance().stage_record(*category_, level, index_, message, [&](RecordEncoder& encoder) {
+        (encoder.add(fields), ...);
+    });
+}
+
+template<typename MakeData>
+void DebugSubitem::log_lazy(Level level, std::string_view message, MakeData&& make_data) {
+    if (!category_->enabled()) return;
+    Debugger::instance().stage_record(*category_, level, index_, message, [&](RecordEncoder& encoder) {
+        encoder.add_data(make_data());
+    });
+}
+
+template<typename MakeData>
+void Debugger::send_lazy(const Category& category, Level level, std::string_view message, MakeData&& make_data) {
+    if (!category.enabled()) return;
+    stage_record(category, level, 0, message, [&](RecordEncoder& encoder) {
+        encoder.add_data(make_data());
+    });
+}
+
+template<typename... Ts>
+void Debugger::emit(const Category& category, Level level, std::string_view message, const FieldArg<Ts>&... fields) {
+    if (!category.enabled()) return;
+    stage_record(category, level, 0, message, [&](RecordEncoder& encoder) {
+        (encoder.add(fields), ...);
+    });
+}
+
+template<typename Encode>
+void Debugger::stage_record(const Category& category, Level level, uint64_t subitem,
+                            std::string_view message, Encode&& encode) {
+    // Acquire pairs with init so lane setup is visible before first use
+    if (!running_.load(std::memory_order_acquire)) return;
+    
+    const uint64_t timestamp = RecordClock::now();
+    
+    // Sampled-out and throttled records are turned away before anything is
+    // encoded
+    float sample_weight = 0;
+    if (Sampler* sampler = category.sampler()) [[unlikely]] {
+        sample_weight = sampler->sample(timestamp);
+        if (sample_weight == 0) return;
+    }
+    if (Throttle* throttle = category.throttle()) [[unlikely]] {
+        if (!admit(*throttle, category, level, subitem, message, timestamp)) return;
+    }
+    write_record(category, level, subitem, message, timestamp, sample_weight, std::forward<Encode>(encode));
+}
+
+template<typename Encode>
+void Debugger::write_record(const Category& category, Level level, uint64_t subitem,
+                            std::string_view message, uint64_t timestamp, float sample_weight, Encode&& encode) {
+    FlightRecorder* recorder = flight_recorder_.load(std::memory_order_acquire);
+    if (!category.routed()) [[unlikely]] {
+        // Enabled only for the flight recorder; nothing to dispatch
+        if (recorder) {
+            thread_local std::vector<std::byte> scratch;
+            scratch.clear();
+            RecordEncoder encoder(scratch, category.id(), level, subitem,
+                                  timestamp, message);
+            encoder.set_sample_weight(sample_weight);
+            encoder.set_sequence(next_sequence_.fetch_add(1, std::memory_order_relaxed));
+            encode(encoder);
+            encoder.finish();
+            recorder->append(RecordView(scratch.data()));
+        }
+        return;
+    }
+    
+    const size_t slot = slot_for(category, level);
+    StagingBuffer& buffer = local_staging_buffer();
+    std::unique_lock lock(buffer.mutex, std::try_to_lock);
+    if (!lock.owns_lock()) [[unlikely]] {
+        // A dispatcher is sweeping this buffer
+        const auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        if (collect_stats_) {
+            buffer.enqueue_wait.record(static_cast<uint64_t>(
+                std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count()));
+        }
+    }
+    if (collect_stats_) {
+        buffer.messages.add(category.id());
+        if (subitem != 0) buffer.subitem_messages.add(subitem);
+    }
+    Stage& stage = open_record(buffer, slot);
+    if (category.has_unreported()) [[unlikely]] {
+        stage_loss_report(stage, category, timestamp);
+    }
+    RecordEncoder encoder(stage.batch->bytes, category.id(), level, subitem,
+                          timestamp, message);
+    encoder.set_sample_weight(sample_weight);
+    encoder.set_sequence(next_sequence_.fetch_add(1, std::memory_order_relaxed));
+    encode(encoder);
+    const size_t offset = encoder.finish();
+    
+    // Recorded before the hand-off, so it survives even if the record never
+    // leaves this thread's staging buffer
+    if (recorder) {
+        recorder->append(RecordView(stage.batch->bytes.data() + offset));
+    }
+    close_record(buffer, slot);
+}
+
+void Debugger::start_lanes(auto scheduler) {
+    running_.store(true);
+    for (size_t lane = 0; lane < num_lanes_; ++lane) {
+        active_loops_.fetch_add(1);
+        
+        // Each lane is a long-running processing loop on the scheduler
+        auto work = stdexec::schedule(scheduler)
+            | stdexec::then([this, lane] { run_lane(lane); });
+
+        // Start the work detached
+        stdexec::start_detached(std::move(work));
+    }
+}
+
 template<typename Scheduler>
-void Debugger::init_with_scheduler(Scheduler scheduler) {
+void Debugger::init_with_scheduler(Scheduler scheduler, const Options& options) {
     if (running_.load()) return;
     
-    running_.store(true);
+    prepare_lanes(options);
     owns_thread_pool_ = false;
-    
-    // Create a sender that processes messages in a loop
-    auto work = stdexec::schedule(scheduler)
-        | stdexec::then([this] {
-            while (running_.load()) {
-                std::unique_lock lock(mutex_);
-                cv_.wait(lock, [this] { 
-                    return !message_queue_.empty() || !running_.load();
-                });
-                
-                if (!running_.load() && message_queue_.empty()) {
-                    break;
-                }
-                
-                process_messages();
-            }
-        });
-
-    // Start the work detached
-    stdexec::start_detached(std::move(work));
+    start_lanes(scheduler);
 }
 
-// Helper macro for easy message sending
+// Helper macro for easy message sending. The category is resolved once per
+// call site, so it must be a string literal; anything else fails to compile
+// (use send_message for categories computed at runtime). When nothing
+// listens to it, neither the message nor the data arguments are evaluated,
+// and the data is not built for records the category's throttle turns away.
 #define DEBUG_LOG(category, message, ...) \
-    debugger::Debugger::instance().send_message(category, message, {__VA_ARGS__})
+    do { \
+        static ::debugger::Category& debug_log_category_ = \
+            ::debugger::Debugger::instance().intern_category("" category); \
+        if (debug_log_category_.enabled()) { \
+            ::debugger::Debugger::instance().send_lazy(debug_log_category_, ::debugger::Level::info, message, \
+                [&] { return ::debugger::json{__VA_ARGS__}; }); \
+        } \
+    } while (0)
+
+// Log through a subitem at a compile-time level. Calls below
+// DEBUGGER_MIN_LEVEL compile to nothing, and the arguments are not evaluated
+// unless something listens to the subitem's category; the data is not built
+// for records its throttle turns away.
+#define DEBUG_SUBITEM_LOG(subitem, level, message, ...) \
+    do { \
+        if constexpr (::debugger::level_enabled(level)) { \
+            auto& debug_subitem_ = *(subitem); \
+            if (debug_subitem_.enabled()) { \
+                debug_subitem_.log_lazy(level, message, [&] { return ::debugger::json{__VA_ARGS__}; }); \
+            } \
+        } \
+    } while (0)
 
 } // namespace debugger
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <debugger/log_file.hpp>
+#include <debugger/sink.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace debugger {
+
+class MappedFile;
+
+struct FileSinkOptions {
+    std::filesystem::path directory = ".";
+    // Segments are named <prefix>-<sequence>.dlog
+    std::string prefix = "debug";
+    // Preallocated size of each segment, header included
+    size_t segment_size = size_t{64} << 20;
+    // Rotate a segment once it is this old, even if not full; 0 = never
+    std::chrono::milliseconds max_segment_age{0};
+    // Delete the oldest segments beyond this many, counting the one being
+    // written; 0 = keep everything
+    size_t max_segments = 0;
+    // How often the background thread starts writing dirty pages back
+    std::chrono::milliseconds flush_interval{1000};
+};
+
+struct FileSinkStats {
+    uint64_t records_written{0};
+    // Records that did not fit an empty segment, or arrived while no segment
+    // could be created
+    uint64_t records_dropped{0};
+    uint64_t bytes_written{0};
+    uint64_t segments_created{0};
+    uint64_t segments_deleted{0};
+    // Rotations that found no preallocated segment and had to create one
+    uint64_t rotation_stalls{0};
+};
+
+// Appends records to memory-mapped segment files (see log_file.hpp for the
+// layout). write() only copies the encoded records into the mapping; a
+// background thread preallocates the next segment, starts write-back of
+// dirty pages every flush_interval, and closes and deletes old segments. The
+// dispatch thread never makes a blocking write call, and data reaches the
+// page cache as soon as it is copied, so it survives a crash of the process
+// (though not of the machine) even before it is flushed.
+//
+// A sink may be shared by several lanes; writes are serialized.
+class FileSink : public Sink {
+public:
+    explicit FileSink(FileSinkOptions options);
+    ~FileSink() override;
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    void write(std::span<const RecordView> records, const BatchInfo& info) override;
+
+    // Write the active segment back to disk and wait for it
+    void flush() override;
+
+    // False while no segment could be created (e.g. the directory is not
+    // writable); records are dropped until one can
+    bool is_open() const;
+
+    // Path of the segment being written, empty if none
+    std::filesystem::path current_segment() const;
+
+    FileSinkStats stats() const;
+
+private:
+    struct Segment {
+        std::unique_ptr<MappedFile> file;
+        uint64_t sequence{0};
+        size_t used{0};
+        size_t flushed{0};      // Owned by the background thread
+        uint64_t first_timestamp{0};
+        uint64_t last_timestamp{0};
+        std::chrono::steady_clock::time_point opened;
+        // Ids already named by a dictionary record in this segment
+        std::unordered_set<uint32_t> categories;
+        std::unordered_set<uint64_t> subitems;
+
+        SegmentHeader& header() const;
+    };
+
+    void run();
+    std::filesystem::path segment_path(uint64_t sequence) const;
+    std::unique_ptr<Segment> create_segment(uint64_t sequence);
+    void close_segment(Segment& segment);
+    void discard_segment(std::unique_ptr<Segment> segment);
+    void enforce_retention(size_t keep);
+
+    // The following run with mutex_ held
+    bool rotate();
+    void describe(const RecordView& record);
+    bool append(const RecordView& record);
+    void publish(Segment& segment);
+
+    const FileSinkOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::unique_ptr<Segment> active_;
+    std::unique_ptr<Segment> spare_;
+    std::vector<std::unique_ptr<Segment>> retired_;
+    uint64_t next_sequence_{0};
+    bool stopping_{false};
+
+    // Dictionary records for the record being appended
+    std::vector<std::byte> scratch_;
+    std::vector<uint32_t> new_categories_;
+    std::vector<uint64_t> new_subitems_;
+
+    // Closed segments on disk, oldest first; background thread only
+    std::deque<std::filesystem::path> closed_;
+
+    std::atomic<uint64_t> records_written_{0};
+    std::atomic<uint64_t> records_dropped_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> segments_created_{0};
+    std::atomic<uint64_t> segments_deleted_{0};
+    std::atomic<uint64_t> rotation_stalls_{0};
+
+    std::thread thread_;
+};
+
+} // namespace debugger
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <debugger/record.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace debugger {
+
+class MappedFile;
+
+// Layout of a flight recorder file:
+//
+//   FlightRecorderHeader             64 bytes
+//   FlightStripe x stripe_count      64 bytes each
+//   dictionary                       dictionary_size bytes
+//   stripe rings x stripe_count      stripe_size bytes each (a power of two)
+//
+// Each stripe is a byte ring that producer threads append frames to. A frame
+// is an 8-byte commit word followed by an encoded record. A writer reserves
+// space by advancing FlightStripe::head, an absolute byte position that never
+// wraps, copies the record in (splitting it at the end of the ring if need
+// be), and finally stores position | 1 in the commit word. A reader only
+// trusts a frame whose commit word matches its own position, which rejects
+// frames still being written as well as leftovers from earlier laps.
+//
+// The dictionary holds record_dictionary records (see log_file.hpp) for every
+// category and subitem, appended as they are created, so the file decodes on
+// its own.
+inline constexpr char flight_recorder_magic[8] = {'D', 'B', 'G', 'F', 'L', 'T', '\0', '\1'};
+
+struct FlightRecorderHeader {
+    char magic[8];
+    uint32_t format_version;    // record_format_version of the records
+    uint32_t stripe_count;
+    uint64_t stripe_size;
+    uint64_t dictionary_offset;
+    uint64_t dictionary_size;
+    uint64_t dictionary_used;   // Bytes of dictionary records written
+    uint64_t data_offset;       // Offset of the first stripe ring
+    uint64_t created;           // Nanoseconds since the Unix epoch
+};
+
+static_assert(sizeof(FlightRecorderHeader) == 64);
+
+// Write position of one stripe, on a cache line of its own
+struct FlightStripe {
+    uint64_t head;
+    uint64_t reserved[7];
+};
+
+static_assert(sizeof(FlightStripe) == 64);
+
+struct FlightRecorderOptions {
+    std::filesystem::path path = "debug.flight";
+    // Total file size; the rings get what the headers and dictionary leave,
+    // rounded down to a power of two per stripe
+    size_t size = size_t{16} << 20;
+    // Rings producers are spread over by thread, so they rarely share a
+    // write position
+    size_t stripes = 4;
+    size_t dictionary_size = size_t{256} << 10;
+};
+
+// Keeps the most recent records in a memory-mapped file. Writes go straight
+// to the shared mapping, so they survive the process being killed; the
+// operating system writes them back on its own schedule. An existing file at
+// the path is first renamed to <path>.1 so a restart does not overwrite the
+// recording of a crash.
+class FlightRecorder {
+public:
+    // Null if the file could not be created
+    static std::unique_ptr<FlightRecorder> create(const FlightRecorderOptions& options);
+
+    ~FlightRecorder();
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    // Copy one encoded record into this thread's stripe. Lock-free and never
+    // blocks; a record bigger than half a stripe is counted and skipped.
+    void append(const RecordView& record) {
+        const size_t size = record.size();
+        if (size + sizeof(uint64_t) > stripe_size_ / 2) [[unlikely]] {
+            oversized_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const size_t stripe = thread_slot() % stripe_count_;
+        std::byte* ring = rings_ + stripe * stripe_size_;
+        const uint64_t position = std::atomic_ref<uint64_t>(stripes_[stripe].head)
+            .fetch_add(sizeof(uint64_t) + size, std::memory_order_relaxed);
+
+        const size_t mask = stripe_size_ - 1;
+        const size_t body = (position + sizeof(uint64_t)) & mask;
+        const size_t first = std::min(size, stripe_size_ - body);
+        std::memcpy(ring + body, record.bytes(), first);
+        std::memcpy(ring, record.bytes() + first, size - first);
+
+        // Positions are 8-byte aligned, so the commit word never wraps
+        auto* commit = reinterpret_cast<uint64_t*>(ring + (position & mask));
+        std::atomic_ref<uint64_t>(*commit).store(position | 1, std::memory_order_release);
+    }
+
+    // Name a category or subitem in the dictionary
+    void describe_category(uint32_t id, std::string_view name);
+    void describe_subitem(uint64_t index, uint32_t category, std::string_view id, std::string_view name);
+
+    const std::filesystem::path& path() const;
+
+    // Records skipped for being too large, and names that did not fit the
+    // dictionary
+    uint64_t oversized() const { return oversized_.load(std::memory_order_relaxed); }
+    uint64_t dictionary_overflow() const { return dictionary_overflow_.load(std::memory_order_relaxed); }
+
+private:
+    FlightRecorder() = default;
+
+    static size_t thread_slot() {
+        static std::atomic<size_t> next{0};
+        thread_local const size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    // Copy scratch_ into the dictionary; caller holds dictionary_mutex_
+    void append_dictionary();
+
+    std::unique_ptr<MappedFile> file_;
+    FlightRecorderHeader* header_{nullptr};
+    FlightStripe* stripes_{nullptr};
+    std::byte* rings_{nullptr};
+    size_t stripe_count_{0};
+    size_t stripe_size_{0};
+
+    std::mutex dictionary_mutex_;
+    std::vector<std::byte> scratch_;
+
+    std::atomic<uint64_t> oversized_{0};
+    std::atomic<uint64_t> dictionary_overflow_{0};
+};
+
+// A flight recorder file read back, typically after the process that wrote
+// it died. Holds a copy of every intact record.
+class FlightRecording {
+public:
+    struct Subitem {
+        uint32_t category;
+        std::string id;
+        std::string name;
+    };
+
+    // Null if the file is missing or not a flight recorder file
+    static std::unique_ptr<FlightRecording> load(const std::filesystem::path& path);
+
+    // Records of all stripes, oldest first
+    const std::vector<RecordView>& records() const { return records_; }
+
+    // Names from the dictionary; empty or null when unknown
+    std::string_view category_name(uint32_t id) const;
+    const Subitem* subitem(uint64_t index) const;
+
+private:
+    std::vector<std::byte> bytes_;
+    std::vector<RecordView> records_;
+    std::unordered_map<uint32_t, std::string> categories_;
+    std::unordered_map<uint64_t, Subitem> subitems_;
+};
+
+} // namespace debugger
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace debugger {
+
+class SocketSink;
+
+// Commands encoded as the newline-terminated {"framework","command",
+// "payload"} frames the GraphView parses (docs/packages.md), collected into
+// batches of about max_bytes so each can go out as one socket write
+struct GraphBatch {
+    std::string bytes;
+    size_t commands{0};
+};
+
+class GraphBatches {
+public:
+    explicit GraphBatches(std::string framework = "System", size_t max_bytes = size_t{1} << 20);
+
+    void append(std::string_view command, const nlohmann::json& payload);
+
+    std::vector<GraphBatch>& batches() { return batches_; }
+
+private:
+    std::string prefix_;    // Everything before the command name
+    size_t max_bytes_;
+    std::vector<GraphBatch> batches_;
+};
+
+// Mirror of the meta-class graph as the UI has been told about it and as it
+// is now. Updates that change nothing (re-creates, setting the current
+// type or parent, adding an edge twice, removing one that is not there)
+// are dropped on arrival; the rest only mark vertices dirty, and
+// take_changes sends the difference, so a vertex created and retyped three
+// times in one window costs one create and one set-type.
+//
+// Vertices are never removed, as the protocol has no command for it. Edges
+// are keyed like the GraphView keys them: one extension edge per
+// extension, name and type, one implementation edge per name, interface
+// and type, and a remove drops every type between the pair.
+//
+// Not thread-safe; GraphEmitter wraps one behind a mutex.
+class GraphState {
+public:
+    void create(std::string_view name);
+    // An empty type is "unknown"
+    void set_type(std::string_view name, std::string_view type);
+    // An empty parent (or "none") removes the vertex's parent
+    void set_parent(std::string_view name, std::string_view parent);
+    // Edge from extension to name; with no type the UI derives it from the
+    // extension's vertex type
+    void add_extension(std::string_view name, std::string_view extension, std::string_view type = {});
+    void remove_extension(std::string_view name, std::string_view extension);
+    // Edge from name to interface
+    void add_interface(std::string_view name, std::string_view iface, std::string_view type);
+    void remove_interface(std::string_view name, std::string_view iface);
+
+    // Append the commands that bring a UI up to date with everything taken
+    // so far to the current state, and count it as up to date
+    void take_changes(GraphBatches& out);
+
+    // Append the commands that build the whole current graph from nothing,
+    // for a UI that lost its state or never had it, and counts it as up to
+    // date. Edge removals still pending come before the edges between the same
+    // pair. A UI that kept its state gets every vertex and edge again,
+    // which relies on the UI ignoring a create for a vertex it has and an
+    // add for an edge id it has, as GraphMessageHandler.ts does.
+    void snapshot(GraphBatches& out);
+
+    bool has_changes() const { return !dirty_.empty(); }
+    size_t vertices() const { return order_.size(); }
+    size_t edges() const;
+
+    // Updates received, and those dropped for changing nothing
+    uint64_t updates() const { return updates_; }
+    uint64_t redundant() const { return redundant_; }
+
+private:
+    // Edge types between a vertex and one other vertex, now and as sent
+    struct EdgeSet {
+        std::vector<std::string> types;
+        std::vector<std::string> sent;
+        bool dirty{false};
+    };
+
+    struct Vertex {
+        std::string name;
+        std::string type{"unknown"};
+        std::string parent;
+        std::map<std::string, EdgeSet, std::less<>> extensions;   // By extension
+        std::map<std::string, EdgeSet, std::less<>> interfaces;   // By interface
+        bool sent{false};
+        std::string sent_type{"unknown"};
+        std::string sent_parent;
+        bool dirty{false};
+    };
+
+    Vertex& vertex(std::string_view name, bool& created);
+    void mark(Vertex& vertex);
+    bool add_edge(std::map<std::string, EdgeSet, std::less<>>& edges, std::string_view other, std::string_view type);
+    bool remove_edges(std::map<std::string, EdgeSet, std::less<>>& edges, std::string_view other);
+    void append_vertex(GraphBatches& out, Vertex& vertex, bool everything);
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    std::unordered_map<std::string, Vertex, NameHash, std::equal_to<>> vertices_;
+    std::vector<Vertex*> order_;    // In creation order
+    std::vector<Vertex*> dirty_;
+    uint64_t updates_{0};
+    uint64_t redundant_{0};
+};
+
+struct GraphEmitterOptions {
+    std::string framework = "System";
+    // How long changes are collected after the first one before they are
+    // sent together
+    std::chrono::milliseconds window{50};
+    // Batches are split at about this size; a snapshot of a large graph
+    // goes out as several
+    size_t max_batch_bytes = size_t{1} << 20;
+};
+
+struct GraphEmitterStats {
+    uint64_t updates{0};
+    uint64_t redundant{0};
+    uint64_t commands_sent{0};
+    uint64_t batches_sent{0};
+    uint64_t resyncs{0};
+    size_t vertices{0};
+    size_t edges{0};
+};
+
+// Takes a batch and returns true, or returns false to be offered it again
+// later, e.g. while the connection is down and its queue full
+using GraphBatchWriter = std::function<bool(GraphBatch& batch)>;
+
+// Thread-safe GraphState that sends its changes once per window from a
+// background thread, as batches of commands. Batches the writer turns away
+// are offered again after a window; changes made meanwhile are merged into
+// the next batch rather than queued behind it.
+//
+//   auto sink = std::make_shared<SocketSink>(SocketSinkOptions{.port = 9000});
+//   GraphEmitter graph(sink);
+//   graph.create("Foo");
+//   graph.set_parent("Foo", "Base");
+//
+// Built on a SocketSink, every (re)connection is followed by a resync, so
+// a UI that restarted is rebuilt in one go.
+class GraphEmitter {
+public:
+    GraphEmitter(GraphBatchWriter writer, GraphEmitterOptions options = {});
+    explicit GraphEmitter(std::shared_ptr<SocketSink> sink, GraphEmitterOptions options = {});
+    // Sends what is still pending, as far as the writer takes it
+    ~GraphEmitter();
+
+    GraphEmitter(const GraphEmitter&) = delete;
+    GraphEmitter& operator=(const GraphEmitter&) = delete;
+
+    void create(std::string_view name);
+    void set_type(std::string_view name, std::string_view type);
+    void set_parent(std::string_view name, std::string_view parent);
+    void add_extension(std::string_view name, std::string_view extension, std::string_view type = {});
+    void remove_extension(std::string_view name, std::string_view extension);
+    void add_interface(std::string_view name, std::string_view iface, std::string_view type);
+    void remove_interface(std::string_view name, std::string_view iface);
+
+    // Send a snapshot of the whole graph next, in place of the changes
+    void resync();
+
+    // Send what is pending without waiting for the window to close, and
+    // wait until the writer took it or turned it away
+    void flush();
+
+    GraphEmitterStats stats() const;
+
+private:
+    template<typename Update>
+    void update(Update&& apply);
+    void run();
+    bool send_outbox(std::unique_lock<std::mutex>& lock);
+
+    const GraphEmitterOptions options_;
+    GraphBatchWriter writer_;
+    std::shared_ptr<SocketSink> sink_;
+    uint64_t seen_connects_{0};
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    GraphState state_;
+    std::vector<GraphBatch> outbox_;
+    size_t outbox_next_{0};
+    std::chrono::steady_clock::time_point window_start_;
+    bool resync_{false};
+    bool blocked_{false};   // The writer turned the last batch away
+    bool stopping_{false};
+    bool exited_{false};
+    uint64_t commands_sent_{0};
+    uint64_t batches_sent_{0};
+    uint64_t resyncs_{0};
+
+    std::thread thread_;
+};
+
+} // namespace debugger
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace debugger {
+
+// Append-only map from dense ids to stable pointers. Lookups never lock and
+// may run concurrently with set(); calls to set() must be serialised by the
+// caller. Storage grows in fixed chunks so published entries never move.
+template<typename T>
+class IdTable {
+public:
+    static constexpr size_t chunk_bits = 10;
+    static constexpr size_t chunk_size = size_t{1} << chunk_bits;
+    static constexpr size_t max_chunks = 1024;
+    static constexpr size_t max_ids = chunk_size * max_chunks;
+
+    IdTable() = default;
+    IdTable(const IdTable&) = delete;
+    IdTable& operator=(const IdTable&) = delete;
+
+    ~IdTable() {
+        for (auto& chunk : chunks_) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    T* get(size_t id) const {
+        if (id >= max_ids) return nullptr;
+        auto* chunk = chunks_[id >> chunk_bits].load(std::memory_order_acquire);
+        return chunk ? chunk[id & (chunk_size - 1)].load(std::memory_order_acquire) : nullptr;
+    }
+
+    // Returns false if id is beyond max_ids
+    bool set(size_t id, T* value) {
+        if (id >= max_ids) return false;
+        auto& slot = chunks_[id >> chunk_bits];
+        auto* chunk = slot.load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new std::atomic<T*>[chunk_size]{};
+            slot.store(chunk, std::memory_order_release);
+        }
+        chunk[id & (chunk_size - 1)].store(value, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<std::atomic<std::atomic<T*>*>, max_chunks> chunks_{};
+};
+
+} // namespace debugger
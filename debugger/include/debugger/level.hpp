@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Lowest level that survives compilation: 0 = debug, 1 = info, 2 = warning,
+// 3 = error. Release builds drop debug-level calls unless overridden.
+#ifndef DEBUGGER_MIN_LEVEL
+#  ifdef NDEBUG
+#    define DEBUGGER_MIN_LEVEL 1
+#  else
+#    define DEBUGGER_MIN_LEVEL 0
+#  endif
+#endif
+
+namespace debugger {
+
+enum class Level : std::uint8_t {
+    debug = 0,
+    info = 1,
+    warning = 2,
+    error = 3
+};
+
+inline constexpr std::size_t level_count = 4;
+
+inline constexpr Level min_level = static_cast<Level>(DEBUGGER_MIN_LEVEL);
+
+// True if calls at this level are compiled in
+constexpr bool level_enabled(Level level) {
+    return level >= min_level;
+}
+
+constexpr std::string_view to_string(Level level) {
+    switch (level) {
+        case Level::debug: return "debug";
+        case Level::info: return "info";
+        case Level::warning: return "warning";
+        case Level::error: return "error";
+    }
+    return "unknown";
+}
+
+} // namespace debugger
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <debugger/record.hpp>
+#include <cstdint>
+#include <cstring>
+
+namespace debugger {
+
+// On-disk layout of the segment files written by FileSink:
+//
+//   SegmentHeader                    64 bytes
+//   records                          RecordEncoder format, back to back
+//   zero padding                     up to the preallocated size
+//
+// A segment is self-describing: before the first record that uses a
+// category or subitem, a dictionary record (flag record_dictionary) names
+// it. Category entries carry the category id and subitem 0, with the name
+// as message. Subitem entries carry the subitem index and its category id,
+// with the name as message and the id string in an "id" field.
+//
+// SegmentHeader::used is updated after every batch, so a segment from a
+// process that died is readable up to the last completed batch.
+inline constexpr char segment_magic[8] = {'D', 'B', 'G', 'S', 'E', 'G', '\0', '\1'};
+
+enum SegmentFlags : uint32_t {
+    // Set once the segment was completed and truncated to its used size
+    segment_closed = 1 << 0
+};
+
+struct SegmentHeader {
+    char magic[8];
+    uint32_t format_version;    // record_format_version of the records
+    uint32_t header_size;       // Offset of the first record
+    uint64_t sequence;          // Segment number, increasing per directory
+    uint64_t created;           // Nanoseconds since the Unix epoch
+    uint64_t used;              // Bytes written, including this header
+    uint64_t first_timestamp;   // Of the first and last record, 0 if empty
+    uint64_t last_timestamp;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SegmentHeader) == 64);
+
+inline bool valid_segment_header(const SegmentHeader& header) {
+    return std::memcmp(header.magic, segment_magic, sizeof(segment_magic)) == 0
+        && header.header_size >= sizeof(SegmentHeader)
+        && header.format_version == record_format_version;
+}
+
+} // namespace debugger
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <debugger/level.hpp>
+#include <debugger/record.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace debugger {
+
+// Which records a LogReader query returns; empty or default members match
+// everything
+struct LogQuery {
+    // Exact category name, or a pattern using the subscriber rules
+    // ("application.*", "application.**")
+    std::string category;
+    // Subitem id string as shown in subitem_id
+    std::string subitem_id;
+    // Records at this level and above
+    Level min_level = Level::debug;
+    // Timestamp range in nanoseconds since the Unix epoch, from inclusive,
+    // to exclusive
+    uint64_t from = 0;
+    uint64_t to = std::numeric_limits<uint64_t>::max();
+};
+
+// A matching record with the names its segment gave its ids
+struct LogEntry {
+    const RecordView& record;
+    std::string_view category;
+    std::string_view subitem_id;    // Empty when not sent through a subitem
+    std::string_view subitem_name;
+};
+
+struct LogReaderOptions {
+    // Records of a segment are summarized per block of about this many bytes
+    size_t block_size = size_t{64} << 10;
+    // Save the index of each closed segment next to it as <segment>.idx, so
+    // only the first query pays for building it
+    bool cache_index = true;
+};
+
+// Blocks and segments a query could rule out from the index alone
+struct LogQueryStats {
+    uint64_t segments_skipped{0};
+    uint64_t blocks_skipped{0};
+    uint64_t blocks_scanned{0};
+    uint64_t records_scanned{0};
+    uint64_t records_matched{0};
+};
+
+// Queries the segment files written by FileSink, and flight recorder files.
+//
+// Each segment gets a sparse index: its dictionary, plus for every block the
+// timestamp range, the levels present and small bloom masks of the category
+// and subitem ids in it. A query maps its names to ids with the dictionary
+// and only decodes blocks whose summary may match, so a narrow query over a
+// large capture touches a small part of it. Flight recordings are small and
+// filtered in full.
+class LogReader {
+public:
+    // Open every segment and flight recording in a directory, or single
+    // files; paths that cannot be read are skipped
+    explicit LogReader(const std::vector<std::filesystem::path>& paths, LogReaderOptions options = {});
+    ~LogReader();
+
+    LogReader(const LogReader&) = delete;
+    LogReader& operator=(const LogReader&) = delete;
+
+    // Files that were opened, in query order
+    std::vector<std::filesystem::path> files() const;
+
+    // Call fn for each matching record, segment by segment in the order they
+    // were written. Return false from fn to stop early.
+    LogQueryStats query(const LogQuery& query, const std::function<bool(const LogEntry&)>& fn);
+
+private:
+    struct Source;
+
+    void add_file(const std::filesystem::path& path);
+
+    const LogReaderOptions options_;
+    std::vector<std::unique_ptr<Source>> sources_;
+};
+
+} // namespace debugger
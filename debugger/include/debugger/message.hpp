@@ -1,5 +1,6 @@
 #pragma once
 
+#include <debugger/clock.hpp>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <chrono>
@@ -9,7 +10,8 @@ namespace debugger {
 class DebugMessage {
 public:
     DebugMessage(std::string category, std::string message, nlohmann::json data = {})
-        : timestamp_(std::chrono::system_clock::now())
+        : timestamp_(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              std::chrono::nanoseconds(RecordClock::now())))
         , category_(std::move(category))
         , message_(std::move(message))
         , data_(std::move(data)) {}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace debugger {
+
+enum class MetricKind : uint8_t {
+    counter,
+    gauge,
+    histogram
+};
+
+// Log-linear buckets for Histogram: values below 8 get a bucket each, and
+// each power of two above is split into 8 equal buckets, so a bucket's
+// bounds are within 1/8 of each other over the whole uint64_t range.
+struct MetricBuckets {
+    static constexpr unsigned sub_bits = 3;
+    static constexpr size_t sub_count = size_t{1} << sub_bits;
+    static constexpr size_t count = (64 - sub_bits + 1) * sub_count;
+
+    static size_t bucket_for(uint64_t value) {
+        if (value < sub_count) return static_cast<size_t>(value);
+        const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - 1 - sub_bits;
+        return (shift + 1) * sub_count + static_cast<size_t>((value >> shift) & (sub_count - 1));
+    }
+
+    // Smallest and largest value counted in bucket b
+    static uint64_t lower_bound(size_t bucket) {
+        if (bucket < sub_count) return bucket;
+        return (sub_count + bucket % sub_count) << (bucket / sub_count - 1);
+    }
+    static uint64_t upper_bound(size_t bucket) {
+        return bucket + 1 == count ? UINT64_MAX : lower_bound(bucket + 1) - 1;
+    }
+};
+
+// Handles returned by DebugSubitem::counter, gauge and histogram. They are
+// cheap to copy and stay valid for the life of the process; a
+// default-constructed handle ignores updates.
+
+// Monotonic count, summed per thread without locked instructions
+class Counter {
+public:
+    Counter() = default;
+
+    void add(uint64_t n = 1) const;
+    void increment() const { add(1); }
+
+    explicit operator bool() const { return slot_ != 0; }
+
+private:
+    friend class DebugSubitem;
+    explicit Counter(uint32_t slot) : slot_(slot) {}
+
+    uint32_t slot_{0};
+};
+
+// Last value set, shared by all threads
+class Gauge {
+public:
+    Gauge() = default;
+
+    void set(double value) const {
+        if (value_) value_->store(value, std::memory_order_relaxed);
+    }
+    void add(double delta) const {
+        if (value_) value_->fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    explicit operator bool() const { return value_ != nullptr; }
+
+private:
+    friend class DebugSubitem;
+    explicit Gauge(std::atomic<double>* value) : value_(value) {}
+
+    std::atomic<double>* value_{nullptr};
+};
+
+// Distribution of unsigned values (durations in nanoseconds, sizes in
+// bytes, ...) in MetricBuckets, counted per thread like Counter
+class Histogram {
+public:
+    Histogram() = default;
+
+    void record(uint64_t value) const;
+
+    explicit operator bool() const { return slot_ != 0; }
+
+private:
+    friend class DebugSubitem;
+    explicit Histogram(uint32_t slot) : slot_(slot) {}
+
+    // Its sum, then its buckets
+    uint32_t slot_{0};
+};
+
+} // namespace debugger
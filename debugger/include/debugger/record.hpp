@@ -0,0 +1,411 @@
+#pragma once
+
+#include <debugger/level.hpp>
+#include <nlohmann/json.hpp>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace debugger {
+
+using json = nlohmann::json;
+
+// Binary record layout shared by the queue and every binary sink:
+//
+//   RecordHeader                     40 bytes, 8-byte aligned
+//   message   u32 length + bytes
+//   fields    field_count x { u8 type, u8 key length, key bytes, value }
+//   padding   up to the next multiple of 8
+//
+// Values are bool (u8), int64/uint64/float64 (8 bytes), or string/json
+// (u32 length + bytes; json values are MessagePack). Multi-byte values are
+// stored in host byte order and read with memcpy, so fields need no alignment.
+inline constexpr uint32_t record_format_version = 2;
+
+enum class FieldType : uint8_t {
+    null = 0,
+    boolean = 1,
+    int64 = 2,
+    uint64 = 3,
+    float64 = 4,
+    string = 5,
+    json = 6
+};
+
+enum RecordFlags : uint8_t {
+    // The record's data is a single json field with an empty key rather than
+    // an object built from its fields; no fields at all means null data
+    record_raw_data = 1 << 0,
+    // Synthetic record standing in for records lost to queue overflow; its
+    // "lost" field holds how many
+    record_loss_report = 1 << 1,
+    // Names a category or subitem id in a stored log (see log_file.hpp);
+    // never delivered to handlers
+    record_dictionary = 1 << 2,
+    // Summary of repeats a throttle collapsed: the repeated record's level,
+    // subitem and message, with "repeated", "first_timestamp" and
+    // "last_timestamp" fields
+    record_repeat_summary = 1 << 3,
+    // Synthetic record counting records a rate limit turned away, in its
+    // "suppressed" field
+    record_rate_limited = 1 << 4,
+    // A finished Span: the message is its name, with "begin" and "duration"
+    // (nanoseconds), "thread", "span_id", "parent_id" (0 at the top level)
+    // and "depth" fields
+    record_span = 1 << 5,
+    // A subitem's metrics summary (see DebugSubitem::counter); its raw data
+    // holds "interval" (nanoseconds) and "counters", "gauges" and
+    // "histograms" objects keyed by metric name
+    record_metrics = 1 << 6,
+    // Some fields were left out, for having a key over max_field_key bytes
+    // or coming after the first max_fields (see RecordEncoder::add)
+    record_fields_dropped = 1 << 7
+};
+
+inline constexpr size_t max_field_key = 255;
+inline constexpr size_t max_fields = UINT16_MAX;
+
+struct RecordHeader {
+    uint32_t size;          // Encoded size including header and padding
+    uint32_t category;      // Interned category id
+    uint64_t timestamp;     // Nanoseconds since the Unix epoch (see RecordClock)
+    uint64_t sequence;      // Order the debugger accepted it in, from 1; 0 for records it did not send
+    uint64_t subitem;       // Subitem index, 0 when not sent through a subitem
+    Level level;
+    uint8_t flags;
+    uint16_t field_count;
+    float sample_weight;    // Records this one stands for after sampling; 0 when not sampled
+};
+
+static_assert(sizeof(RecordHeader) == 40);
+static_assert(std::is_trivially_copyable_v<RecordHeader>);
+
+inline constexpr size_t record_alignment = 8;
+
+// A typed key/value argument for the allocation-free logging API
+template<typename T>
+struct FieldArg {
+    std::string_view key;
+    const T& value;
+};
+
+template<typename T>
+FieldArg<T> field(std::string_view key, const T& value) {
+    return {key, value};
+}
+
+// One decoded field; string and json views point into the record
+class FieldView {
+public:
+    FieldView(std::string_view key, FieldType type, const std::byte* value, uint32_t length)
+        : key_(key), type_(type), value_(value), length_(length) {}
+
+    std::string_view key() const { return key_; }
+    FieldType type() const { return type_; }
+
+    bool as_bool() const { return std::to_integer<uint8_t>(value_[0]) != 0; }
+    int64_t as_int() const { return load<int64_t>(); }
+    uint64_t as_uint() const { return load<uint64_t>(); }
+    double as_double() const { return load<double>(); }
+    std::string_view as_string() const {
+        return {reinterpret_cast<const char*>(value_), length_};
+    }
+
+    json to_json() const {
+        switch (type_) {
+            case FieldType::null: return nullptr;
+            case FieldType::boolean: return as_bool();
+            case FieldType::int64: return as_int();
+            case FieldType::uint64: return as_uint();
+            case FieldType::float64: return as_double();
+            case FieldType::string: return as_string();
+            case FieldType::json:
+                return json::from_msgpack(reinterpret_cast<const uint8_t*>(value_),
+                                          reinterpret_cast<const uint8_t*>(value_) + length_);
+        }
+        return nullptr;
+    }
+
+private:
+    template<typename V>
+    V load() const {
+        V v;
+        std::memcpy(&v, value_, sizeof(V));
+        return v;
+    }
+
+    std::string_view key_;
+    FieldType type_;
+    const std::byte* value_;
+    uint32_t length_;
+};
+
+// Read-only view of an encoded record. Does not own the bytes.
+class RecordView {
+public:
+    explicit RecordView(const std::byte* data)
+        : data_(data) {}
+
+    const RecordHeader& header() const {
+        return *reinterpret_cast<const RecordHeader*>(data_);
+    }
+
+    const std::byte* bytes() const { return data_; }
+    size_t size() const { return header().size; }
+    uint32_t category_id() const { return header().category; }
+    Level level() const { return header().level; }
+    uint64_t timestamp() const { return header().timestamp; }
+    uint64_t sequence() const { return header().sequence; }
+    uint64_t subitem() const { return header().subitem; }
+    uint16_t field_count() const { return header().field_count; }
+    // How many records this one stands for: 1 unless its category is sampled
+    float sample_weight() const { return header().sample_weight > 0 ? header().sample_weight : 1.0f; }
+    bool raw_data() const { return (header().flags & record_raw_data) != 0; }
+    bool loss_report() const { return (header().flags & record_loss_report) != 0; }
+    bool dictionary() const { return (header().flags & record_dictionary) != 0; }
+    bool repeat_summary() const { return (header().flags & record_repeat_summary) != 0; }
+    bool rate_limited() const { return (header().flags & record_rate_limited) != 0; }
+    bool span() const { return (header().flags & record_span) != 0; }
+    bool metrics() const { return (header().flags & record_metrics) != 0; }
+    bool fields_dropped() const { return (header().flags & record_fields_dropped) != 0; }
+
+    std::string_view message() const {
+        uint32_t length;
+        std::memcpy(&length, data_ + sizeof(RecordHeader), sizeof(length));
+        return {reinterpret_cast<const char*>(data_ + sizeof(RecordHeader) + sizeof(length)), length};
+    }
+
+    // Invoke fn(const FieldView&) for each field in encoding order
+    template<typename Fn>
+    void for_each_field(Fn&& fn) const {
+        const std::byte* p = data_ + sizeof(RecordHeader);
+        uint32_t length;
+        std::memcpy(&length, p, sizeof(length));
+        p += sizeof(length) + length;
+
+        for (uint16_t i = 0; i < field_count(); ++i) {
+            const auto type = static_cast<FieldType>(p[0]);
+            const auto key_length = std::to_integer<uint8_t>(p[1]);
+            const std::string_view key(reinterpret_cast<const char*>(p + 2), key_length);
+            p += 2 + key_length;
+
+            switch (type) {
+                case FieldType::null: length = 0; break;
+                case FieldType::boolean: length = 1; break;
+                case FieldType::int64:
+                case FieldType::uint64:
+                case FieldType::float64: length = 8; break;
+                case FieldType::string:
+                case FieldType::json:
+                    std::memcpy(&length, p, sizeof(length));
+                    p += sizeof(length);
+                    break;
+            }
+            fn(FieldView(key, type, p, length));
+            p += length;
+        }
+    }
+
+    // The record's data payload as json: an object of its fields, or the
+    // raw value it was sent with
+    json data() const {
+        if (raw_data()) {
+            json result;
+            for_each_field([&](const FieldView& field) { result = field.to_json(); });
+            return result;
+        }
+        json result = json::object();
+        for_each_field([&](const FieldView& field) {
+            result[std::string(field.key())] = field.to_json();
+        });
+        return result;
+    }
+
+private:
+    const std::byte* data_;
+};
+
+// Appends one record to a byte buffer. Construct, add fields, then finish().
+// Appending to a buffer with enough reserved capacity does not allocate.
+class RecordEncoder {
+public:
+    RecordEncoder(std::vector<std::byte>& out, uint32_t category, Level level,
+                  uint64_t subitem, uint64_t timestamp, std::string_view message)
+        : out_(out)
+        , start_(out.size()) {
+        RecordHeader header{};
+        header.category = category;
+        header.timestamp = timestamp;
+        header.subitem = subitem;
+        header.level = level;
+        append(&header, sizeof(header));
+        append_string(message);
+    }
+
+    RecordEncoder(const RecordEncoder&) = delete;
+    RecordEncoder& operator=(const RecordEncoder&) = delete;
+
+    // Keys are limited to max_field_key bytes and a record to max_fields
+    // fields. A field past either limit is left out rather than cut short
+    // or wrapped around; the record is then flagged record_fields_dropped
+    // and dropped_fields() counts them.
+    template<typename T>
+    void add(std::string_view key, const T& value) {
+        using V = std::remove_cvref_t<T>;
+        if constexpr (std::is_same_v<V, bool>) {
+            if (!begin_field(FieldType::boolean, key)) return;
+            const uint8_t v = value ? 1 : 0;
+            append(&v, 1);
+        } else if constexpr (std::is_enum_v<V>) {
+            add(key, static_cast<std::underlying_type_t<V>>(value));
+        } else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>) {
+            if (!begin_field(FieldType::int64, key)) return;
+            const int64_t v = value;
+            append(&v, sizeof(v));
+        } else if constexpr (std::is_integral_v<V>) {
+            if (!begin_field(FieldType::uint64, key)) return;
+            const uint64_t v = value;
+            append(&v, sizeof(v));
+        } else if constexpr (std::is_floating_point_v<V>) {
+            if (!begin_field(FieldType::float64, key)) return;
+            const double v = value;
+            append(&v, sizeof(v));
+        } else if constexpr (std::is_same_v<V, std::nullptr_t>) {
+            begin_field(FieldType::null, key);
+        } else if constexpr (std::is_same_v<V, json>) {
+            add_json(key, value);
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            if (!begin_field(FieldType::string, key)) return;
+            append_string(std::string_view(value));
+        } else {
+            add_json(key, json(value));
+        }
+    }
+
+    template<typename T>
+    void add(const FieldArg<T>& arg) {
+        add(arg.key, arg.value);
+    }
+
+    // Encode a json value, storing scalars as typed fields
+    void add_json(std::string_view key, const json& value) {
+        switch (value.type()) {
+            case json::value_t::null: add(key, nullptr); break;
+            case json::value_t::boolean: add(key, value.get<bool>()); break;
+            case json::value_t::number_integer: add(key, value.get<int64_t>()); break;
+            case json::value_t::number_unsigned: add(key, value.get<uint64_t>()); break;
+            case json::value_t::number_float: add(key, value.get<double>()); break;
+            case json::value_t::string: add(key, std::string_view(value.get_ref<const std::string&>())); break;
+            default: {
+                if (!begin_field(FieldType::json, key)) return;
+                thread_local std::vector<uint8_t> scratch;
+                scratch.clear();
+                json::to_msgpack(value, scratch);
+                append_length(scratch.size());
+                append(scratch.data(), scratch.size());
+                break;
+            }
+        }
+    }
+
+    // Encode a json payload the way send_message receives it: objects become
+    // one field per member, anything else is stored as raw data
+    void add_data(const json& data) {
+        if (data.is_object()) {
+            for (const auto& [key, value] : data.items()) {
+                add_json(key, value);
+            }
+        } else {
+            header_flags_ |= record_raw_data;
+            if (!data.is_null()) {
+                add_json({}, data);
+            }
+        }
+    }
+
+    void add_flags(uint8_t flags) {
+        header_flags_ |= flags;
+    }
+
+    void set_sample_weight(float weight) {
+        sample_weight_ = weight;
+    }
+
+    void set_sequence(uint64_t sequence) {
+        sequence_ = sequence;
+    }
+
+    // Fields add() left out for exceeding a limit
+    size_t dropped_fields() const { return dropped_fields_; }
+
+    // Patch the header and pad to alignment; returns the record's offset
+    size_t finish() {
+        static constexpr std::byte zeros[record_alignment]{};
+        const size_t unpadded = out_.size() - start_;
+        const size_t padded = (unpadded + record_alignment - 1) & ~(record_alignment - 1);
+        append(zeros, padded - unpadded);
+
+        auto* header = reinterpret_cast<RecordHeader*>(out_.data() + start_);
+        header->size = static_cast<uint32_t>(padded);
+        header->field_count = field_count_;
+        header->flags = header_flags_;
+        header->sample_weight = sample_weight_;
+        header->sequence = sequence_;
+        return start_;
+    }
+
+private:
+    void append(const void* data, size_t size) {
+        const auto* bytes = static_cast<const std::byte*>(data);
+        out_.insert(out_.end(), bytes, bytes + size);
+    }
+
+    void append_length(size_t length) {
+        const auto v = static_cast<uint32_t>(length);
+        append(&v, sizeof(v));
+    }
+
+    void append_string(std::string_view value) {
+        append_length(value.size());
+        append(value.data(), value.size());
+    }
+
+    bool begin_field(FieldType type, std::string_view key) {
+        if (key.size() > max_field_key || field_count_ == max_fields) [[unlikely]] {
+            ++dropped_fields_;
+            header_flags_ |= record_fields_dropped;
+            return false;
+        }
+        const uint8_t prefix[2] = {static_cast<uint8_t>(type), static_cast<uint8_t>(key.size())};
+        append(prefix, sizeof(prefix));
+        append(key.data(), key.size());
+        ++field_count_;
+        return true;
+    }
+
+    std::vector<std::byte>& out_;
+    size_t start_;
+    uint16_t field_count_{0};
+    size_t dropped_fields_{0};
+    uint8_t header_flags_{0};
+    float sample_weight_{0};
+    uint64_t sequence_{0};
+};
+
+// Iterate the records packed in a buffer produced by RecordEncoder
+template<typename Fn>
+void for_each_record(const std::byte* data, size_t size, Fn&& fn) {
+    size_t offset = 0;
+    while (offset + sizeof(RecordHeader) <= size) {
+        RecordView view(data + offset);
+        if (view.size() < sizeof(RecordHeader) || offset + view.size() > size) break;
+        fn(view);
+        offset += view.size();
+    }
+}
+
+} // namespace debugger
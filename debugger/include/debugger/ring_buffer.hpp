@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace debugger {
+
+// Bounded multi-producer, multi-consumer ring buffer (Vyukov's bounded
+// queue).
+//
+// Producers claim a slot with a CAS on the tail index and publish it through
+// the slot's sequence number, so the enqueue path never takes a lock.
+// try_pop() claims the head the same way, so any number of threads may pop
+// at once. The debugger has one regular consumer per ring, its lane, but
+// producers also pop to evict the oldest entry of a full ring.
+template<typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(std::size_t capacity)
+        : capacity_(std::bit_ceil(std::max<std::size_t>(capacity, 2)))
+        , mask_(capacity_ - 1)
+        , slots_(std::make_unique<Slot[]>(capacity_)) {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    // Enqueue a value; returns false without blocking when the ring is full
+    template<typename U>
+    bool try_push(U&& value) {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq - pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::forward<U>(value);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Dequeue the oldest published value; safe to call from any thread
+    bool try_pop(T& out) {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(slot.value);
+                    slot.sequence.store(pos + capacity_, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // True when there is nothing published to pop
+    bool empty() const {
+        const std::size_t pos = head_.load(std::memory_order_relaxed);
+        return slots_[pos & mask_].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    // Number of claimed slots; may be stale by the time it is read
+    std::size_t size_approx() const {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        return tail >= head ? tail - head : 0;
+    }
+
+    std::size_t capacity() const { return capacity_; }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        T value{};
+    };
+
+    static constexpr std::size_t cache_line = 64;
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(cache_line) std::atomic<std::size_t> tail_{0};
+    alignas(cache_line) std::atomic<std::size_t> head_{0};
+};
+
+} // namespace debugger
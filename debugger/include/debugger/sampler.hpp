@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace debugger {
+
+enum class SamplingMode : uint8_t {
+    none,           // Keep everything
+    probability,    // Keep each record with a fixed probability
+    one_in_n,       // Keep every n-th record
+    adaptive        // Adjust the probability to stay near target_rate
+};
+
+// Producer-side sampling for one category, set with Debugger::set_sampling
+// or DebugSubitem::set_sampling. Kept records carry the number of records
+// they stand for in RecordView::sample_weight().
+struct SamplingOptions {
+    SamplingMode mode = SamplingMode::none;
+    double probability = 1.0;               // For probability
+    uint32_t one_in = 1;                    // For one_in_n
+    double target_rate = 1000;              // For adaptive: records per second to keep
+    std::chrono::milliseconds adapt_interval{100};  // How often adaptive re-measures the rate
+};
+
+// Decides which records of a category are kept. Lock-free: probability
+// draws from a per-thread generator, the other modes share one counter.
+class Sampler {
+public:
+    explicit Sampler(const SamplingOptions& options)
+        : mode_(options.mode)
+        , one_in_(std::max<uint32_t>(options.one_in, 1))
+        , target_rate_(options.target_rate)
+        , interval_(static_cast<uint64_t>(std::chrono::nanoseconds(options.adapt_interval).count()))
+        , budget_(std::max<uint64_t>(static_cast<uint64_t>(options.target_rate * static_cast<double>(interval_) / 1e9), 1)) {
+        threshold_.store(threshold_for(options.mode == SamplingMode::probability ? options.probability : 1.0),
+                         std::memory_order_relaxed);
+    }
+
+    Sampler(const Sampler&) = delete;
+    Sampler& operator=(const Sampler&) = delete;
+
+    static bool active(const SamplingOptions& options) {
+        switch (options.mode) {
+            case SamplingMode::none: return false;
+            case SamplingMode::probability: return options.probability < 1.0;
+            case SamplingMode::one_in_n: return options.one_in > 1;
+            case SamplingMode::adaptive: return true;
+        }
+        return false;
+    }
+
+    // Weight of a record sent at timestamp (nanoseconds): 0 to drop it,
+    // otherwise how many offered records it stands for
+    float sample(uint64_t timestamp) {
+        switch (mode_) {
+            case SamplingMode::none:
+                return 1.0f;
+            case SamplingMode::one_in_n:
+                return counter_.fetch_add(1, std::memory_order_relaxed) % one_in_ == 0
+                    ? static_cast<float>(one_in_) : 0.0f;
+            case SamplingMode::adaptive: {
+                // Re-measure every interval, or early once the window's
+                // budget is used up so a sudden burst is caught quickly
+                counter_.fetch_add(1, std::memory_order_relaxed);
+                const uint64_t start = window_start_.load(std::memory_order_relaxed);
+                if (timestamp > start && (timestamp - start >= interval_
+                                          || kept_.load(std::memory_order_relaxed) >= budget_)) [[unlikely]] {
+                    adapt(start, timestamp);
+                }
+                break;
+            }
+            case SamplingMode::probability:
+                break;
+        }
+        const uint64_t threshold = threshold_.load(std::memory_order_relaxed);
+        if (threshold != always && random() >= threshold) return 0.0f;
+        if (mode_ == SamplingMode::adaptive) {
+            kept_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return threshold == always ? 1.0f : static_cast<float>(two_to_64 / static_cast<double>(threshold));
+    }
+
+    // Current probability of keeping a record
+    double probability() const {
+        const uint64_t threshold = threshold_.load(std::memory_order_relaxed);
+        return threshold == always ? 1.0 : static_cast<double>(threshold) / two_to_64;
+    }
+
+private:
+    static constexpr uint64_t always = std::numeric_limits<uint64_t>::max();
+    static constexpr double two_to_64 = 18446744073709551616.0;
+
+    static uint64_t threshold_for(double probability) {
+        if (probability >= 1.0) return always;
+        if (probability <= 0.0) return 0;
+        return static_cast<uint64_t>(probability * two_to_64);
+    }
+
+    // xorshift64*, seeded once per thread
+    static uint64_t random() {
+        thread_local uint64_t state = std::random_device{}() | (uint64_t{std::random_device{}()} << 32) | 1;
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    void adapt(uint64_t start, uint64_t now) {
+        // One producer per window wins the exchange and sets the probability
+        // for the next one from the rate offered in this one
+        uint64_t expected = start;
+        if (!window_start_.compare_exchange_strong(expected, now, std::memory_order_relaxed)) return;
+        const uint64_t offered = counter_.exchange(0, std::memory_order_relaxed);
+        kept_.store(0, std::memory_order_relaxed);
+        if (start == 0) return;  // First window: no rate yet
+        const double rate = static_cast<double>(offered) * 1e9 / static_cast<double>(now - start);
+        threshold_.store(threshold_for(rate > target_rate_ ? target_rate_ / rate : 1.0), std::memory_order_relaxed);
+    }
+
+    const SamplingMode mode_;
+    const uint32_t one_in_;
+    const double target_rate_;
+    const uint64_t interval_;
+    const uint64_t budget_;     // Records to keep per interval
+    std::atomic<uint64_t> threshold_{always};
+    std::atomic<uint64_t> counter_{0};
+    std::atomic<uint64_t> window_start_{0};
+    std::atomic<uint64_t> kept_{0};
+};
+
+} // namespace debugger
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdexec/execution.hpp>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+namespace debugger {
+
+class Category;
+
+// A point every lane it was handed to must pass: each lane sends out its
+// staged and queued records, then counts remaining down, and whichever lane
+// reaches zero runs complete
+struct FlushWaiter {
+    std::atomic<size_t> remaining{0};
+    void (*complete)(FlushWaiter& waiter) noexcept{nullptr};
+};
+
+// Hand waiter to the lane of category, or to every lane if category is
+// null. Completes it at once if the debugger is not running.
+void request_flush(FlushWaiter& waiter, const Category* category);
+
+template<typename Send, typename Receiver>
+class DeliveryOperation : FlushWaiter {
+public:
+    using operation_state_concept = stdexec::operation_state_t;
+
+    DeliveryOperation(Send send, Receiver receiver)
+        : send_(std::move(send))
+        , receiver_(std::move(receiver)) {}
+
+    DeliveryOperation(const DeliveryOperation&) = delete;
+    DeliveryOperation& operator=(const DeliveryOperation&) = delete;
+
+    void start() & noexcept {
+        complete = [](FlushWaiter& waiter) noexcept {
+            stdexec::set_value(std::move(static_cast<DeliveryOperation&>(waiter).receiver_));
+        };
+        // Nothing was handed to a lane yet, so complete here
+        const Category* category = nullptr;
+        try {
+            category = send_();
+        } catch (...) {
+            stdexec::set_error(std::move(receiver_), std::current_exception());
+            return;
+        }
+        request_flush(*this, category);
+    }
+
+private:
+    Send send_;
+    Receiver receiver_;
+};
+
+// Sender that stages records when started and completes once they have
+// been delivered to handlers and sinks. send() stages them and returns the
+// category whose lane to wait for, or null to wait for every lane.
+//
+// If send() throws, it completes with set_error and the exception instead,
+// on the thread that started it.
+//
+// It completes on the dispatch lane that delivered last, so move anything
+// slow elsewhere, e.g. with stdexec::continues_on(sender, scheduler);
+// waiting on another delivery from there would stall the lane.
+template<typename Send>
+class DeliverySender {
+public:
+    using sender_concept = stdexec::sender_t;
+    using completion_signatures = stdexec::completion_signatures<
+        stdexec::set_value_t(), stdexec::set_error_t(std::exception_ptr)>;
+
+    explicit DeliverySender(Send send)
+        : send_(std::move(send)) {}
+
+    template<typename Receiver>
+    DeliveryOperation<Send, Receiver> connect(Receiver receiver) && {
+        return DeliveryOperation<Send, Receiver>(std::move(send_), std::move(receiver));
+    }
+
+    template<typename Receiver>
+    DeliveryOperation<Send, Receiver> connect(Receiver receiver) const& {
+        return DeliveryOperation<Send, Receiver>(send_, std::move(receiver));
+    }
+
+private:
+    Send send_;
+};
+
+// Stages nothing: waits for what is already staged or queued
+struct NoRecords {
+    const Category* category{nullptr};
+    const Category* operator()() const { return category; }
+};
+
+using FlushSender = DeliverySender<NoRecords>;
+
+} // namespace debugger
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <debugger/batch.hpp>
+#include <debugger/record.hpp>
+#include <span>
+
+namespace debugger {
+
+// An output for records, attached with Debugger::add_sink. write() runs on a
+// dispatch lane and should hand the batch off rather than wait on I/O; a
+// sink attached to several lanes' categories is called from each of them.
+class Sink {
+public:
+    virtual ~Sink() = default;
+
+    virtual void write(std::span<const RecordView> records, const BatchInfo& info) = 0;
+
+    // Push out anything buffered; may block
+    virtual void flush() {}
+};
+
+} // namespace debugger
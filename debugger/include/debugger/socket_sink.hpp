@@ -0,0 +1,115 @@
+#pragma once
+
+#include <debugger/sink.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace debugger {
+
+struct SocketSinkOptions {
+    std::string host = "127.0.0.1";
+    uint16_t port = 0;
+    // Frame fields the Electron SocketServer dispatches on
+    std::string framework = "Debugger";
+    std::string command = "debug:message";
+    // Encoded bytes waiting to be sent; batches arriving beyond this are
+    // dropped rather than stalling the dispatcher
+    size_t max_queued_bytes = size_t{8} << 20;
+    // Delay before reconnecting, doubled after each failure up to the maximum
+    std::chrono::milliseconds reconnect_delay{100};
+    std::chrono::milliseconds max_reconnect_delay{5000};
+    std::chrono::milliseconds connect_timeout{1000};
+    // How long the destructor keeps sending what is still queued
+    std::chrono::milliseconds close_timeout{1000};
+};
+
+struct SocketSinkStats {
+    uint64_t frames_sent{0};
+    uint64_t frames_dropped{0};
+    uint64_t bytes_sent{0};
+    uint64_t writes{0};
+    uint64_t connects{0};
+};
+
+// Streams records over TCP as the {"framework","command","payload"} json
+// frames parsed by electron/ipc/handlers/socket.ts, one per line. The
+// payload is the handler json plus "category", "level" and "timestamp".
+//
+// write() only encodes the batch and queues it; a background thread sends
+// everything queued with one vectored write per pass and reconnects with
+// exponential backoff. A batch that was partly sent when the connection
+// dropped is sent again in full on the next connection.
+class SocketSink : public Sink {
+public:
+    explicit SocketSink(SocketSinkOptions options);
+    ~SocketSink() override;
+
+    SocketSink(const SocketSink&) = delete;
+    SocketSink& operator=(const SocketSink&) = delete;
+
+    void write(std::span<const RecordView> records, const BatchInfo& info) override;
+
+    // Wait until everything queued so far was sent, or the connection is down
+    void flush() override;
+
+    // Queue frames encoded elsewhere (newline-terminated, e.g. by
+    // GraphEmitter) behind everything written so far. Takes bytes if they
+    // fit in max_queued_bytes; otherwise leaves them and returns false.
+    bool send_frames(std::string& bytes, size_t frames);
+
+    bool connected() const { return connected_.load(std::memory_order_relaxed); }
+    SocketSinkStats stats() const;
+
+    // Append the frame for one record, newline terminated
+    void append_frame(std::string& out, const RecordView& record) const;
+
+private:
+#ifdef _WIN32
+    using NativeSocket = uintptr_t;
+#else
+    using NativeSocket = int;
+#endif
+
+    // One encoded batch; sent counts bytes already written from it
+    struct Chunk {
+        std::string bytes;
+        size_t frames{0};
+        size_t sent{0};
+    };
+
+    void run();
+    bool connect_once();
+    bool send_chunks(std::deque<Chunk>& chunks);
+    void disconnect();
+    bool peer_closed();
+
+    const SocketSinkOptions options_;
+    std::string frame_prefix_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<Chunk> queue_;
+    size_t queued_bytes_{0};
+    bool sending_{false};
+    bool stopping_{false};
+    bool exited_{false};
+
+    std::atomic<NativeSocket> socket_;
+    std::atomic<bool> connected_{false};
+    std::atomic<uint64_t> frames_sent_{0};
+    std::atomic<uint64_t> frames_dropped_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> writes_{0};
+    std::atomic<uint64_t> connects_{0};
+
+    std::thread thread_;
+};
+
+} // namespace debugger
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace debugger {
+
+class DebugSubitem;
+
+// A timed region of work, opened with DebugSubitem::span and recorded as a
+// single record when it ends (see record_span). A span opened while another
+// is open on the same thread nests inside it, even if the outer one ends
+// or is destroyed first. Spans must end on the thread that opened them
+// (asserted), and their name must outlive them (normally a literal).
+//
+//   auto span = subitem->span("load config");
+//   ...
+//   // recorded here, with begin, duration, thread and parent span
+class Span {
+public:
+    // An inactive span that records nothing
+    Span() = default;
+    ~Span() { end(); }
+
+    // Its thread's open spans point at it, so it stays where it opened
+    Span(const Span&) = delete;
+    Span(Span&&) = delete;
+    Span& operator=(const Span&) = delete;
+    Span& operator=(Span&&) = delete;
+
+    // Record the span now rather than at the end of the scope
+    void end() {
+        if (subitem_) finish();
+    }
+
+    // False when nothing listened to the subitem as the span opened
+    bool active() const { return subitem_ != nullptr; }
+
+    uint64_t id() const { return id_; }
+    uint64_t parent_id() const { return parent_; }
+    uint32_t depth() const { return depth_; }
+
+    // The innermost active span open on this thread, or null
+    static const Span* current();
+
+private:
+    friend class DebugSubitem;
+
+    Span(const DebugSubitem& subitem, std::string_view name);
+    void finish();
+
+    const DebugSubitem* subitem_{nullptr};
+    std::string_view name_;
+    uint64_t begin_{0};
+    uint64_t id_{0};
+    uint64_t parent_{0};
+    uint32_t thread_{0};
+    uint32_t depth_{0};
+    uint32_t slot_{0};      // Index among its thread's open spans
+};
+
+} // namespace debugger
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace debugger {
+
+// Category Debugger publishes its own stats on when
+// DebuggerOptions::stats_interval is set
+inline constexpr std::string_view stats_category = "debugger.stats";
+
+// Log-scale histogram of durations in nanoseconds. Bucket b counts values
+// of bit width b, i.e. [2^(b-1), 2^b), so percentiles are accurate to a
+// factor of two.
+struct LatencyHistogram {
+    static constexpr size_t bucket_count = 48;
+
+    std::array<uint64_t, bucket_count> buckets{};
+    uint64_t count{0};
+    uint64_t sum{0};
+    uint64_t max{0};
+
+    static size_t bucket_for(uint64_t ns) {
+        return std::min<size_t>(static_cast<size_t>(std::bit_width(ns)), bucket_count - 1);
+    }
+
+    void record(uint64_t ns) {
+        ++buckets[bucket_for(ns)];
+        ++count;
+        sum += ns;
+        max = std::max(max, ns);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t b = 0; b < bucket_count; ++b) {
+            buckets[b] += other.buckets[b];
+        }
+        count += other.count;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    double mean() const { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+
+    // Upper bound of the bucket holding the q-quantile, capped at max
+    uint64_t percentile(double q) const {
+        if (count == 0) return 0;
+        const auto rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < bucket_count; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                return b == 0 ? 0 : std::min(max, (uint64_t{1} << b) - 1);
+            }
+        }
+        return max;
+    }
+};
+
+// Live LatencyHistogram updated by one thread at a time and read by any
+class HistogramCounter {
+public:
+    void record(uint64_t ns) {
+        bump(buckets_[LatencyHistogram::bucket_for(ns)], 1);
+        bump(count_, 1);
+        bump(sum_, ns);
+        if (ns > max_.load(std::memory_order_relaxed)) {
+            max_.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    LatencyHistogram snapshot() const {
+        LatencyHistogram result;
+        for (size_t b = 0; b < LatencyHistogram::bucket_count; ++b) {
+            result.buckets[b] = buckets_[b].load(std::memory_order_relaxed);
+        }
+        result.count = count_.load(std::memory_order_relaxed);
+        result.sum = sum_.load(std::memory_order_relaxed);
+        result.max = max_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    // Single writer: a plain add, published without a locked instruction
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, LatencyHistogram::bucket_count> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Counters indexed by a dense id, updated by one thread at a time and read
+// by any. Storage grows in chunks like IdTable, so readers never see a
+// counter move.
+class CounterArray {
+public:
+    static constexpr size_t chunk_bits = 10;
+    static constexpr size_t chunk_size = size_t{1} << chunk_bits;
+    static constexpr size_t max_chunks = 1024;
+
+    CounterArray() = default;
+    CounterArray(const CounterArray&) = delete;
+    CounterArray& operator=(const CounterArray&) = delete;
+
+    ~CounterArray() {
+        for (auto& chunk : chunks_) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    void add(size_t id, uint64_t n = 1) {
+        if (id >= chunk_size * max_chunks) return;
+        auto& slot = chunks_[id >> chunk_bits];
+        auto* chunk = slot.load(std::memory_order_relaxed);
+        if (!chunk) [[unlikely]] {
+            chunk = new std::atomic<uint64_t>[chunk_size]{};
+            slot.store(chunk, std::memory_order_release);
+        }
+        auto& counter = chunk[id & (chunk_size - 1)];
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        if (id >= size_.load(std::memory_order_relaxed)) {
+            size_.store(id + 1, std::memory_order_release);
+        }
+    }
+
+    uint64_t get(size_t id) const {
+        if (id >= chunk_size * max_chunks) return 0;
+        auto* chunk = chunks_[id >> chunk_bits].load(std::memory_order_acquire);
+        return chunk ? chunk[id & (chunk_size - 1)].load(std::memory_order_relaxed) : 0;
+    }
+
+    // One past the highest id ever added to
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+
+    // Add every counter into totals, growing it as needed
+    void accumulate(std::vector<uint64_t>& totals) const {
+        const size_t n = size();
+        if (totals.size() < n) {
+            totals.resize(n);
+        }
+        for (size_t id = 0; id < n; ++id) {
+            totals[id] += get(id);
+        }
+    }
+
+private:
+    std::array<std::atomic<std::atomic<uint64_t>*>, max_chunks> chunks_{};
+    std::atomic<size_t> size_{0};
+};
+
+// One dispatch lane
+struct LaneStats {
+    size_t index{0};
+    // Records handed to the lane and not yet dispatched, and the most there
+    // have ever been
+    uint64_t queue_depth{0};
+    uint64_t high_water{0};
+    // Producer batches still being filled for this lane
+    uint64_t staged_batches{0};
+    uint64_t dispatched{0};
+    // Time from a record's timestamp to the lane picking it up, for all
+    // records and for errors alone
+    LatencyHistogram dispatch_lag;
+    LatencyHistogram error_lag;
+    // Time spent delivering batches to batch handlers and sinks
+    LatencyHistogram batch_time;
+};
+
+struct CategoryStats {
+    uint32_t id{0};
+    std::string name;
+    // Records staged by producers
+    uint64_t messages{0};
+    uint64_t dropped{0};
+    uint64_t overwritten{0};
+    // Records its throttle held back as repeats or turned away
+    uint64_t collapsed{0};
+    uint64_t suppressed{0};
+    // Current probability of its sampler keeping a record
+    double sample_probability{1.0};
+    // Time spent on each record in handlers and subscribers, over all lanes
+    LatencyHistogram handler_time;
+};
+
+struct SubitemStats {
+    uint64_t index{0};
+    std::string id;
+    std::string name;
+    std::string category;
+    uint64_t messages{0};
+};
+
+// Snapshot of the debugger's own counters since it was created. Counters
+// are kept per thread and per lane and only summed here.
+struct DebuggerStats {
+    std::chrono::steady_clock::time_point taken;
+    std::vector<LaneStats> lanes;
+    // Time producers spent waiting for their staging buffer or for queue space
+    LatencyHistogram enqueue_wait;
+    // All lanes' dispatch lag together
+    LatencyHistogram dispatch_lag;
+    LatencyHistogram error_lag;
+    // Categories and subitems that have seen any traffic, by id
+    std::vector<CategoryStats> categories;
+    std::vector<SubitemStats> subitems;
+
+    uint64_t queue_depth() const {
+        uint64_t depth = 0;
+        for (const auto& lane : lanes) depth += lane.queue_depth;
+        return depth;
+    }
+};
+
+// The form published on stats_category. With an earlier snapshot,
+// categories and subitems also get messages_per_second over the interval
+// and are listed busiest first.
+nlohmann::json to_json(const DebuggerStats& stats, const DebuggerStats* previous = nullptr);
+
+} // namespace debugger
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <debugger/batch.hpp>
 #include <nlohmann/json.hpp>
 #include <functional>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 #include <mutex>
@@ -13,6 +16,7 @@ using json = nlohmann::json;
 class DebugSubscriber {
 public:
     using Callback = std::function<void(const json&)>;
+    using BatchCallback = std::function<void(std::span<const json>, const BatchInfo&)>;
 
     explicit DebugSubscriber(std::string category);
     ~DebugSubscriber();
@@ -20,20 +24,41 @@ public:
     // Subscribe to messages from this subscriber
     void subscribe(Callback callback);
 
+    // Subscribe to receive messages in batches instead of one at a time.
+    // Replaces any callback set by subscribe(), and vice versa
+    void subscribe_batch(BatchCallback callback, BatchOptions options = {});
+
+    // Subscribe to receive encoded records in batches; no json is built.
+    // Replaces any other callback, like subscribe_batch
+    void subscribe_records(BatchHandler handler, BatchOptions options = {});
+
     // Unsubscribe from messages
     void unsubscribe();
 
     // Get the category this subscriber is listening to
     const std::string& category() const { return category_; }
 
-    // Called by Debugger to deliver messages
+    // Deliver a message to the current callback, if any. The Debugger does
+    // not call this; it publishes callback() into its dispatch tables instead
     void deliver(const json& message);
 
+    // Current callback, or null while unsubscribed
+    std::shared_ptr<const Callback> callback() const;
+
+    // Current batch callback, or null unless subscribed with subscribe_batch
+    std::shared_ptr<const BatchSink> batch_sink() const;
+
+    // Called after every subscribe/unsubscribe so the owner can republish
+    void set_change_listener(std::function<void()> listener);
+
 private:
+    void notify_change();
+
     std::string category_;
-    Callback callback_;
-    std::mutex mutex_;
-    bool subscribed_{false};
+    std::shared_ptr<const Callback> callback_;
+    std::shared_ptr<const BatchSink> batch_sink_;
+    std::function<void()> on_change_;
+    mutable std::mutex mutex_;
 };
 
 } // namespace debugger
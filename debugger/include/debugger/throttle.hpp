@@ -0,0 +1,97 @@
+#pragma once
+
+#include <debugger/level.hpp>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace debugger {
+
+// Producer-side limits for one category, set with Debugger::set_throttle or
+// DebugSubitem::set_throttle
+struct ThrottleOptions {
+    // Token bucket: records per second sustained, and how many may arrive at
+    // once. A zero rate turns rate limiting off; a zero burst allows one
+    // second's worth.
+    double rate = 0;
+    double burst = 0;
+    // Collapse consecutive records with the same level, subitem and message
+    // into the first one plus a summary counting the repeats. Repeats do not
+    // use up the rate limit.
+    bool collapse_repeats = false;
+    // Longest a run of repeats or rate-limited records goes unreported
+    std::chrono::milliseconds report_window{1000};
+};
+
+// Records a Throttle wants sent in place of the ones it held back
+struct ThrottleReport {
+    // A finished run of repeats of message
+    uint64_t repeats{0};
+    Level level{Level::info};
+    uint64_t subitem{0};
+    std::string message;
+    uint64_t first_timestamp{0};
+    uint64_t last_timestamp{0};
+    // Records the rate limit turned away
+    uint64_t suppressed{0};
+};
+
+// Rate limit and repeat state of one category, shared by every thread
+// logging to it. Only categories with a throttle pay for the lock.
+class Throttle {
+public:
+    explicit Throttle(const ThrottleOptions& options);
+
+    Throttle(const Throttle&) = delete;
+    Throttle& operator=(const Throttle&) = delete;
+
+    void configure(const ThrottleOptions& options);
+
+    // True if the options limit anything
+    static bool active(const ThrottleOptions& options) {
+        return options.rate > 0 || options.collapse_repeats;
+    }
+
+    // Decide on one record with its timestamp in nanoseconds. Returns false
+    // if it must not be sent. Either way, report may hold records to send
+    // before it.
+    bool admit(Level level, uint64_t subitem, std::string_view message, uint64_t timestamp,
+               ThrottleReport& report);
+
+    // Hand over a repeat run or suppressed count older than report_window,
+    // or any at all when force is set. Returns false if there is none.
+    bool take_stale(uint64_t now, bool force, ThrottleReport& report);
+
+    // When take_stale will next have something, or 0 if nothing is pending
+    uint64_t due() const;
+
+    // Records held back since the throttle was created
+    uint64_t collapsed() const;
+    uint64_t suppressed() const;
+
+private:
+    void take_repeats(ThrottleReport& report);
+
+    mutable std::mutex mutex_;
+    ThrottleOptions options_;
+    double tokens_{0};
+    uint64_t refilled_{0};
+
+    bool has_last_{false};
+    Level last_level_{Level::info};
+    uint64_t last_subitem_{0};
+    std::string last_message_;
+
+    uint64_t repeats_{0};
+    uint64_t first_repeat_{0};
+    uint64_t last_repeat_{0};
+    uint64_t suppressed_{0};
+    uint64_t first_suppressed_{0};
+
+    uint64_t total_collapsed_{0};
+    uint64_t total_suppressed_{0};
+};
+
+} // namespace debugger
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace debugger {
+
+// Values registered under dotted topic patterns, matched segment by segment:
+//
+//   application.NetworkModule   exactly that topic
+//   application.*               exactly one segment below application
+//   application.**              one or more segments below application
+//
+// Not thread-safe; the owner serialises all access.
+template<typename T>
+class TopicTrie {
+public:
+    void insert(std::string_view pattern, T value) {
+        Node* node = &root_;
+        for (auto segment : split(pattern)) {
+            auto& child = node->children[std::string(segment)];
+            if (!child) {
+                child = std::make_unique<Node>();
+            }
+            node = child.get();
+        }
+        node->values.push_back(std::move(value));
+        ++size_;
+    }
+
+    // Remove the values registered under exactly pattern for which pred is
+    // true; returns how many were removed
+    template<typename Pred>
+    size_t erase_if(std::string_view pattern, Pred&& pred) {
+        Node* node = find_node(pattern);
+        if (!node) return 0;
+        const size_t removed = std::erase_if(node->values, std::forward<Pred>(pred));
+        size_ -= removed;
+        return removed;
+    }
+
+    // Values registered under exactly pattern, or null if there are none
+    const std::vector<T>* find(std::string_view pattern) const {
+        const Node* node = find_node(pattern);
+        return node && !node->values.empty() ? &node->values : nullptr;
+    }
+
+    // Invoke fn(const T&) once for every value whose pattern matches topic
+    template<typename Fn>
+    void match(std::string_view topic, Fn&& fn) const {
+        if (size_ == 0) return;
+
+        std::vector<const Node*> nodes;
+        collect(root_, split(topic), 0, nodes);
+
+        // A pattern such as a.**.** can match one topic in several ways
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        for (const Node* node : nodes) {
+            for (const auto& value : node->values) {
+                fn(value);
+            }
+        }
+    }
+
+    // Invoke fn(const T&) for every value in the trie
+    template<typename Fn>
+    void for_each(Fn&& fn) const {
+        visit(root_, fn);
+    }
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    // True if a single pattern matches topic, using the same rules as match()
+    static bool matches(std::string_view pattern, std::string_view topic) {
+        return matches(split(pattern), 0, split(topic), 0);
+    }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>, Hash, std::equal_to<>> children;
+        std::vector<T> values;
+
+        const Node* child(std::string_view segment) const {
+            auto it = children.find(segment);
+            return it != children.end() ? it->second.get() : nullptr;
+        }
+    };
+
+    static std::vector<std::string_view> split(std::string_view topic) {
+        std::vector<std::string_view> segments;
+        size_t start = 0;
+        for (;;) {
+            const size_t dot = topic.find('.', start);
+            segments.push_back(topic.substr(start, dot - start));
+            if (dot == std::string_view::npos) break;
+            start = dot + 1;
+        }
+        return segments;
+    }
+
+    Node* find_node(std::string_view pattern) const {
+        const Node* node = &root_;
+        for (auto segment : split(pattern)) {
+            node = node->child(segment);
+            if (!node) return nullptr;
+        }
+        return const_cast<Node*>(node);
+    }
+
+    static void collect(const Node& node, const std::vector<std::string_view>& topic, size_t index,
+                        std::vector<const Node*>& out) {
+        if (index == topic.size()) {
+            if (!node.values.empty()) {
+                out.push_back(&node);
+            }
+            return;
+        }
+        if (const Node* exact = node.child(topic[index])) {
+            collect(*exact, topic, index + 1, out);
+        }
+        if (const Node* any = node.child("*")) {
+            collect(*any, topic, index + 1, out);
+        }
+        if (const Node* deep = node.child("**")) {
+            for (size_t next = index + 1; next <= topic.size(); ++next) {
+                collect(*deep, topic, next, out);
+            }
+        }
+    }
+
+    static bool matches(const std::vector<std::string_view>& pattern, size_t p,
+                        const std::vector<std::string_view>& topic, size_t t) {
+        if (p == pattern.size()) return t == topic.size();
+        if (pattern[p] == "**") {
+            for (size_t next = t + 1; next <= topic.size(); ++next) {
+                if (matches(pattern, p + 1, topic, next)) return true;
+            }
+            return false;
+        }
+        if (t == topic.size()) return false;
+        if (pattern[p] != "*" && pattern[p] != topic[t]) return false;
+        return matches(pattern, p + 1, topic, t + 1);
+    }
+
+    template<typename Fn>
+    static void visit(const Node& node, Fn& fn) {
+        for (const auto& value : node.values) {
+            fn(value);
+        }
+        for (const auto& [segment, child] : node.children) {
+            visit(*child, fn);
+        }
+    }
+
+    Node root_;
+    size_t size_{0};
+};
+
+} // namespace debugger
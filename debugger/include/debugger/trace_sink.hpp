@@ -0,0 +1,54 @@
+#pragma once
+
+#include <debugger/sink.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+namespace debugger {
+
+struct TraceSinkOptions {
+    std::filesystem::path path = "trace.json";
+    // Also export records other than spans, as instant events
+    bool include_messages = false;
+};
+
+// Writes spans (see Span) as Chrome trace-event json, loadable in
+// chrome://tracing and ui.perfetto.dev. Each span becomes a complete ("X")
+// event named after the span, with the category as "cat", the span's thread
+// number as "tid" and the subitem, span id and parent id in "args".
+//
+// Events are appended through a buffered file as batches arrive; the closing
+// bracket is written on destruction, and both viewers also load a file left
+// without it.
+class TraceSink : public Sink {
+public:
+    explicit TraceSink(TraceSinkOptions options);
+    ~TraceSink() override;
+
+    TraceSink(const TraceSink&) = delete;
+    TraceSink& operator=(const TraceSink&) = delete;
+
+    // False if the file could not be created
+    bool is_open() const { return file_ != nullptr; }
+
+    void write(std::span<const RecordView> records, const BatchInfo& info) override;
+    void flush() override;
+
+    uint64_t events_written() const;
+
+    // Append the event for one record, without a separator
+    void append_event(std::string& out, const RecordView& record) const;
+
+private:
+    TraceSinkOptions options_;
+    int pid_;
+    mutable std::mutex mutex_;
+    std::FILE* file_{nullptr};
+    std::string buffer_;
+    uint64_t events_{0};
+};
+
+} // namespace debugger
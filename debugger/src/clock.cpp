@@ -0,0 +1,154 @@
+#include <debugger/clock.hpp>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if DEBUGGER_HAS_TSC && !defined(_MSC_VER)
+#  include <cpuid.h>
+#endif
+
+namespace debugger {
+
+namespace {
+
+// How long calibrate() spends measuring the counter's rate
+constexpr auto calibration_time = std::chrono::milliseconds(5);
+
+// Largest share by which recalibrate() speeds the clock up or slows it
+// down to catch up with steady_clock
+constexpr double max_slew = 0.005;
+
+uint64_t steady_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t system_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Where steady_clock was pinned to system_clock; the counter is kept in
+// step with the time this gives
+uint64_t pinned_steady = 0;
+uint64_t pinned_system = 0;
+
+#if DEBUGGER_HAS_TSC
+uint64_t reference_ns(uint64_t steady) {
+    return pinned_system + (steady - pinned_steady);
+}
+
+// The counter ticks at a constant rate across power states and cores
+bool invariant_tsc() {
+#  if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, static_cast<int>(0x80000000));
+    if (static_cast<unsigned>(regs[0]) < 0x80000007u) return false;
+    __cpuid(regs, static_cast<int>(0x80000007));
+    return (regs[3] & (1 << 8)) != 0;
+#  else
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+    return (edx & (1u << 8)) != 0;
+#  endif
+}
+
+struct ClockPair {
+    uint64_t ticks;
+    uint64_t ns;    // steady_clock
+};
+
+// Counter reading paired with the middle of the tightest of a few
+// steady_clock brackets around it, so a preemption or a slow read does not
+// skew the measured rate
+ClockPair read_pair() {
+    ClockPair pair{0, 0};
+    uint64_t best = UINT64_MAX;
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        const uint64_t before = steady_ns();
+        const uint64_t ticks = __rdtsc();
+        const uint64_t after = steady_ns();
+        if (after - before < best) {
+            best = after - before;
+            pair = {ticks, before + (after - before) / 2};
+        }
+    }
+    return pair;
+}
+
+// Guarded by calibration_mutex
+std::mutex calibration_mutex;
+bool calibrated = false;
+ClockPair first_pair{0, 0};     // Start of the rate measurement
+ClockPair last_pair{0, 0};      // Previous (re)calibration
+#endif
+
+} // namespace
+
+RecordClock::Calibration::Calibration() {
+    pinned_steady = steady_ns();
+    pinned_system = system_ns();
+    base_ticks.store(pinned_steady, std::memory_order_relaxed);
+    base_ns.store(pinned_system, std::memory_order_relaxed);
+}
+
+void RecordClock::publish(Calibration& c, uint64_t base_ticks, uint64_t base_ns, double ns_per_tick) {
+    // Caller holds calibration_mutex; from here on now() reads the counter
+    const uint32_t version = c.version.load(std::memory_order_relaxed);
+    c.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    c.tsc.store(true, std::memory_order_relaxed);
+    c.base_ticks.store(base_ticks, std::memory_order_relaxed);
+    c.base_ns.store(base_ns, std::memory_order_relaxed);
+    c.ns_per_tick.store(ns_per_tick, std::memory_order_relaxed);
+    c.version.store(version + 2, std::memory_order_release);
+}
+
+void RecordClock::calibrate() {
+    Calibration& c = calibration();
+#if DEBUGGER_HAS_TSC
+    std::lock_guard lock(calibration_mutex);
+    if (std::exchange(calibrated, true) || !invariant_tsc()) return;
+    
+    const ClockPair start = read_pair();
+    std::this_thread::sleep_for(calibration_time);
+    const ClockPair end = read_pair();
+    if (end.ticks <= start.ticks || end.ns <= start.ns) return;
+    
+    first_pair = start;
+    last_pair = end;
+    publish(c, end.ticks, reference_ns(end.ns),
+            static_cast<double>(end.ns - start.ns) / static_cast<double>(end.ticks - start.ticks));
+#else
+    (void)c;
+#endif
+}
+
+void RecordClock::recalibrate() {
+#if DEBUGGER_HAS_TSC
+    Calibration& c = calibration();
+    std::lock_guard lock(calibration_mutex);
+    if (!c.tsc.load(std::memory_order_relaxed)) return;
+    
+    const ClockPair pair = read_pair();
+    if (pair.ticks <= last_pair.ticks || pair.ns <= last_pair.ns) return;
+    
+    // Carry on from where the clock reads now, so it stays monotonic, at
+    // the rate measured over the whole run so far, nudged to close the gap
+    // to steady_clock by the next call
+    const uint64_t base_ticks = c.base_ticks.load(std::memory_order_relaxed);
+    const uint64_t current = c.base_ns.load(std::memory_order_relaxed) + static_cast<uint64_t>(
+        static_cast<double>(pair.ticks > base_ticks ? pair.ticks - base_ticks : 0)
+        * c.ns_per_tick.load(std::memory_order_relaxed));
+    const double rate = static_cast<double>(pair.ns - first_pair.ns)
+                      / static_cast<double>(pair.ticks - first_pair.ticks);
+    const double drift = static_cast<double>(reference_ns(pair.ns)) - static_cast<double>(current);
+    const double slew = std::clamp(drift / static_cast<double>(pair.ns - last_pair.ns), -max_slew, max_slew);
+    
+    last_pair = pair;
+    publish(c, pair.ticks, current, rate * (1.0 + slew));
+#endif
+}
+
+} // namespace debugger
@@ -3,106 +3,266 @@
 #include <debugger/subscriber.hpp>
 #include <stdexec/execution.hpp>
 #include <iostream>
-#include <sstream>
-#include <iomanip>
+#include <charconv>
 #include <random>
+#include <optional>
+#include <algorithm>
+#include <bit>
+#include <thread>
+#include <cassert>
+#include <cstring>
+#include <utility>
 
 namespace debugger {
 
+namespace {
+
+constexpr size_t no_lane = static_cast<size_t>(-1);
+
+// Index of the lane whose processing loop runs on this thread
+thread_local size_t dispatcher_lane = no_lane;
+
+// How often lane 0 looks for throttle reports that are due, at the least
+constexpr auto throttle_poll_interval = std::chrono::milliseconds(100);
+
+// How often lane 0 keeps RecordClock in step with steady_clock
+constexpr auto clock_recalibration_interval = std::chrono::seconds(1);
+
+// Most batches a lane's error queue holds, whatever queue_capacity is
+constexpr size_t max_error_batches = 4096;
+
+// Summary of what a histogram counted since reported, which is then
+// brought up to totals (its sum, then its buckets). Null if nothing was.
+json histogram_summary(const uint64_t* totals, std::vector<uint64_t>& reported) {
+    uint64_t count = 0;
+    for (size_t b = 0; b < MetricBuckets::count; ++b) {
+        count += totals[1 + b] - reported[1 + b];
+    }
+    if (count == 0) return nullptr;
+    
+    // Percentiles are the upper bound of the bucket holding them
+    const uint64_t sum = totals[0] - reported[0];
+    const double quantiles[] = {0.5, 0.9, 0.99};
+    const char* names[] = {"p50", "p90", "p99"};
+    json result = {{"count", count}, {"sum", sum},
+                   {"mean", static_cast<double>(sum) / static_cast<double>(count)}};
+    json buckets = json::array();
+    uint64_t seen = 0;
+    size_t next = 0;
+    for (size_t b = 0; b < MetricBuckets::count; ++b) {
+        const uint64_t n = totals[1 + b] - reported[1 + b];
+        if (n == 0) continue;
+        seen += n;
+        for (; next < std::size(quantiles)
+               && seen >= static_cast<uint64_t>(quantiles[next] * static_cast<double>(count - 1)) + 1; ++next) {
+            result[names[next]] = MetricBuckets::upper_bound(b);
+        }
+        result["max"] = MetricBuckets::upper_bound(b);
+        buckets.push_back({MetricBuckets::lower_bound(b), n});
+    }
+    result["buckets"] = std::move(buckets);
+    std::copy(totals, totals + reported.size(), reported.begin());
+    return result;
+}
+
+// Spans open on this thread, innermost last. One that ends before spans
+// opened inside it stays here, marked ended, until they end too; it may be
+// gone by then, so it is never looked at again. The last entry is always
+// a span that is still open.
+struct OpenSpan {
+    Span* span;
+    bool ended;
+};
+thread_local std::vector<OpenSpan> open_spans;
+
+// Count a lane past a flush point; the last one completes it
+void release_flush(FlushWaiter& waiter) {
+    if (waiter.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        waiter.complete(waiter);
+    }
+}
+
+// Small per-thread number for span records, in order of first use
+uint32_t span_thread() {
+    static std::atomic<uint32_t> next{1};
+    thread_local const uint32_t thread = next.fetch_add(1, std::memory_order_relaxed);
+    return thread;
+}
+
+} // namespace
+
 // DebugSubitem implementation
 std::string DebugSubitem::generate_id() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(0, 15);
+    // Only called when a subitem is constructed; records carry index() instead
+    static std::mutex mutex;
+    static std::mt19937_64 gen(std::random_device{}());
     
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (int i = 0; i < 16; ++i) {
-        ss << std::setw(1) << dis(gen);
+    uint64_t value;
+    {
+        std::lock_guard lock(mutex);
+        value = gen();
     }
-    return ss.str();
+    
+    std::string id(16, '0');
+    char digits[16];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value, 16);
+    std::copy(digits, end, id.end() - (end - digits));
+    return id;
 }
 
-void DebugSubitem::log(const std::string& message, const json& data) {
-    json log_data = data;
-    log_data["subitem_id"] = id_;
-    log_data["subitem_name"] = name_;
-    log_data["level"] = "debug";
+DebugSubitem::DebugSubitem(std::string name, std::string parent_category)
+    : name_(std::move(name))
+    , parent_category_(std::move(parent_category))
+    , id_(generate_id())
+    , category_(&Debugger::instance().intern_category(
+          parent_category_.empty() ? name_ : parent_category_ + "." + name_))
+    , index_(Debugger::instance().register_subitem(id_, name_, category_->id())) {}
+
+void DebugSubitem::log_at(Level level, const std::string& message, const json& data) {
+    // Nobody listening: skip encoding and the enqueue entirely
+    if (!category_->enabled()) return;
     
-    std::string category = parent_category_.empty() ? name_ : parent_category_ + "." + name_;
-    Debugger::instance().send_message(category, message, log_data);
+    // subitem_id, subitem_name and level travel in the record header and are
+    // only turned back into json fields for handlers that want json
+    Debugger::instance().stage_record(*category_, level, index_, message, [&](RecordEncoder& encoder) {
+        encoder.add_data(data);
+    });
 }
 
-void DebugSubitem::log_error(const std::string& message, const json& data) {
-    json log_data = data;
-    log_data["subitem_id"] = id_;
-    log_data["subitem_name"] = name_;
-    log_data["level"] = "error";
-    
-    std::string category = parent_category_.empty() ? name_ : parent_category_ + "." + name_;
-    Debugger::instance().send_message(category, message, log_data);
+void DebugSubitem::set_throttle(const ThrottleOptions& options) {
+    Debugger::instance().set_throttle(category_->name(), options);
 }
 
-void DebugSubitem::log_warning(const std::string& message, const json& data) {
-    json log_data = data;
-    log_data["subitem_id"] = id_;
-    log_data["subitem_name"] = name_;
-    log_data["level"] = "warning";
+void DebugSubitem::set_sampling(const SamplingOptions& options) {
+    Debugger::instance().set_sampling(category_->name(), options);
+}
+
+void DebugSubitem::record_span(const Span& span, uint64_t end) const {
+    if (!category_->enabled()) return;
     
-    std::string category = parent_category_.empty() ? name_ : parent_category_ + "." + name_;
-    Debugger::instance().send_message(category, message, log_data);
+    // Past the category's sampler and throttle, which know nothing of
+    // spans: dropping one would orphan its children, and collapsing keys
+    // on the message alone, which for a span is just its name
+    Debugger& debugger = Debugger::instance();
+    if (!debugger.running_.load(std::memory_order_acquire)) return;
+    debugger.write_record(*category_, Level::info, index_, span.name_, RecordClock::now(), 0, [&](RecordEncoder& encoder) {
+        encoder.add_flags(debugger::record_span);
+        encoder.add("begin", span.begin_);
+        encoder.add("duration", end - span.begin_);
+        encoder.add("thread", span.thread_);
+        encoder.add("span_id", span.id_);
+        encoder.add("parent_id", span.parent_);
+        encoder.add("depth", span.depth_);
+    });
+}
+
+Counter DebugSubitem::counter(std::string_view name) const {
+    auto* metric = Debugger::instance().register_metric(*this, MetricKind::counter, name);
+    return metric ? Counter(metric->slot) : Counter();
 }
 
-void DebugSubitem::log_info(const std::string& message, const json& data) {
-    json log_data = data;
-    log_data["subitem_id"] = id_;
-    log_data["subitem_name"] = name_;
-    log_data["level"] = "info";
+Gauge DebugSubitem::gauge(std::string_view name) const {
+    auto* metric = Debugger::instance().register_metric(*this, MetricKind::gauge, name);
+    return metric ? Gauge(&metric->gauge) : Gauge();
+}
+
+Histogram DebugSubitem::histogram(std::string_view name) const {
+    auto* metric = Debugger::instance().register_metric(*this, MetricKind::histogram, name);
+    return metric ? Histogram(metric->slot) : Histogram();
+}
+
+// Metric implementation
+void Counter::add(uint64_t n) const {
+    if (slot_ != 0) {
+        Debugger::instance().local_staging_buffer().metrics.add(slot_, n);
+    }
+}
+
+void Histogram::record(uint64_t value) const {
+    if (slot_ == 0) return;
+    CounterArray& metrics = Debugger::instance().local_staging_buffer().metrics;
+    metrics.add(slot_, value);
+    metrics.add(slot_ + 1 + MetricBuckets::bucket_for(value), 1);
+}
+
+// Span implementation
+Span::Span(const DebugSubitem& subitem, std::string_view name) {
+    // Nothing listening: stay inactive and never read the clock
+    if (!subitem.enabled()) return;
     
-    std::string category = parent_category_.empty() ? name_ : parent_category_ + "." + name_;
-    Debugger::instance().send_message(category, message, log_data);
+    // Ids are unique per process: the thread number above a per-thread count
+    thread_local uint64_t spans_opened = 0;
+    subitem_ = &subitem;
+    name_ = name;
+    thread_ = span_thread();
+    id_ = (uint64_t{thread_} << 40) | ++spans_opened;
+    if (!open_spans.empty()) {
+        const Span& parent = *open_spans.back().span;
+        parent_ = parent.id_;
+        depth_ = parent.depth_ + 1;
+    }
+    slot_ = static_cast<uint32_t>(open_spans.size());
+    open_spans.push_back({this, false});
+    begin_ = RecordClock::now();
+}
+
+void Span::finish() {
+    const uint64_t end = RecordClock::now();
+    // Spans opened inside this one may still be open; they keep its entry
+    assert(slot_ < open_spans.size() && open_spans[slot_].span == this && "span ended on another thread");
+    open_spans[slot_].ended = true;
+    while (!open_spans.empty() && open_spans.back().ended) {
+        open_spans.pop_back();
+    }
+    std::exchange(subitem_, nullptr)->record_span(*this, end);
+}
+
+const Span* Span::current() {
+    return open_spans.empty() ? nullptr : open_spans.back().span;
 }
 
 // Debugger implementation
 void Debugger::init(size_t num_threads) {
+    Options options;
+    options.num_threads = num_threads;
+    init(options);
+}
+
+void Debugger::init(const Options& options) {
     if (running_.load()) return;
     
-    // Create internal thread pool
-    thread_pool_ = std::make_unique<exec::static_thread_pool>(num_threads);
+    prepare_lanes(options);
+    
+    // Create internal thread pool with one thread per lane
+    thread_pool_ = std::make_unique<exec::static_thread_pool>(num_lanes_);
     owns_thread_pool_ = true;
-    running_.store(true);
-    
-    // Get scheduler from thread pool
-    auto scheduler = thread_pool_->get_scheduler();
-    
-    // Start the message processing loop using stdexec
-    auto work = stdexec::schedule(scheduler)
-        | stdexec::then([this] {
-            while (running_.load()) {
-                std::unique_lock lock(mutex_);
-                cv_.wait(lock, [this] { 
-                    return !message_queue_.empty() || !running_.load();
-                });
-                
-                if (!running_.load() && message_queue_.empty()) {
-                    break;
-                }
-                
-                process_messages();
-            }
-        });
-
-    // Start the work detached
-    stdexec::start_detached(std::move(work));
+    
+    // Start one message processing loop per lane using stdexec
+    start_lanes(thread_pool_->get_scheduler());
 }
 
 void Debugger::shutdown() {
     if (!running_.load()) return;
     
+    // So are metrics changed since the last summary
+    if (has_metrics_.load()) {
+        publish_metrics();
+    }
+    
+    // Runs and counts still held by throttles go out before the lanes stop
+    if (has_throttles_.load()) {
+        flush_throttles(true);
+    }
+    
     running_.store(false);
-    cv_.notify_all();
+    wake_all_lanes();
     stop_source_.request_stop();
     
+    // Each lane drains whatever is still queued for it before it exits
+    for (size_t loops = active_loops_.load(); loops != 0; loops = active_loops_.load()) {
+        active_loops_.wait(loops);
+    }
+    
     // Wait for thread pool to finish if we own it
     if (owns_thread_pool_ && thread_pool_) {
         // Thread pool destructor will wait for all work to complete
@@ -112,56 +272,630 @@ void Debugger::shutdown() {
 
 void Debugger::send_message(const std::string& category, const std::string& message, const json& data) {
     if (!running_.load()) return;
+    
+    send_message(resolve_category(category), message, data);
+}
+
+void Debugger::send_message(const Category& category, const std::string& message, const json& data) {
+    if (!category.enabled()) return;
+
+    stage_record(category, Level::info, 0, message, [&](RecordEncoder& encoder) {
+        encoder.add_data(data);
+    });
+}
+
+void Debugger::set_overflow_policy(std::string_view category, OverflowPolicy policy) {
+    std::lock_guard lock(mutex_);
+    intern_locked(category).set_overflow_policy(policy);
+}
+
+void Debugger::set_throttle(std::string_view category, const ThrottleOptions& options) {
+    std::lock_guard lock(mutex_);
+    Category& target = intern_locked(category);
+    if (!Throttle::active(options)) {
+        // The throttle itself stays: producers may still be inside it, and
+        // lane 0 sends whatever it is holding
+        target.set_throttle(nullptr);
+        return;
+    }
+    
+    auto& throttle = throttles_[target.id()];
+    if (throttle) {
+        throttle->configure(options);
+    } else {
+        throttle = std::make_unique<Throttle>(options);
+    }
+    target.set_throttle(throttle.get());
+    has_throttles_.store(true);
+}
+
+void Debugger::set_sampling(std::string_view category, const SamplingOptions& options) {
+    // Replaced samplers stay alive: producers may still be inside them
+    std::lock_guard lock(mutex_);
+    Category& target = intern_locked(category);
+    if (!Sampler::active(options)) {
+        target.set_sampler(nullptr);
+        return;
+    }
+    target.set_sampler(samplers_.emplace_back(std::make_unique<Sampler>(options)).get());
+}
 
+bool Debugger::admit(Throttle& throttle, const Category& category, Level level, uint64_t subitem,
+                     std::string_view message, uint64_t timestamp) {
+    ThrottleReport report;
+    const bool admitted = throttle.admit(level, subitem, message, timestamp, report);
+    send_throttle_report(category, report, timestamp);
+    return admitted;
+}
+
+void Debugger::send_throttle_report(const Category& category, const ThrottleReport& report, uint64_t timestamp) {
+    // Bypasses the throttle: reports are already bounded by report_window
+    if (report.repeats > 0) {
+        write_record(category, report.level, report.subitem, report.message, timestamp, 0, [&](RecordEncoder& encoder) {
+            encoder.add_flags(record_repeat_summary);
+            encoder.add("repeated", report.repeats);
+            encoder.add("first_timestamp", report.first_timestamp);
+            encoder.add("last_timestamp", report.last_timestamp);
+        });
+    }
+    if (report.suppressed > 0) {
+        write_record(category, Level::warning, 0, std::to_string(report.suppressed) + " messages suppressed by rate limit",
+                     timestamp, 0, [&](RecordEncoder& encoder) {
+            encoder.add_flags(record_rate_limited);
+            encoder.add("suppressed", report.suppressed);
+        });
+    }
+}
+
+std::chrono::steady_clock::time_point Debugger::flush_throttles(bool force) {
+    // Collect under mutex_ and send without it. Returns when the next
+    // report falls due
+    const uint64_t now = RecordClock::now();
+    std::vector<std::pair<const Category*, ThrottleReport>> reports;
+    uint64_t next_due = 0;
     {
         std::lock_guard lock(mutex_);
-        message_queue_.push({
-            category,
-            {
-                {"message", message},
-                {"data", data}
-            },
-            std::chrono::system_clock::now()
+        for (const auto& [id, throttle] : throttles_) {
+            ThrottleReport report;
+            if (throttle->take_stale(now, force, report)) {
+                reports.emplace_back(categories_.get(id), std::move(report));
+            }
+            const uint64_t due = throttle->due();
+            if (due != 0 && (next_due == 0 || due < next_due)) {
+                next_due = due;
+            }
+        }
+    }
+    
+    for (const auto& [category, report] : reports) {
+        if (category->enabled()) {
+            send_throttle_report(*category, report, now);
+        }
+    }
+    
+    const auto steady_now = std::chrono::steady_clock::now();
+    if (next_due == 0) return std::chrono::steady_clock::time_point::max();
+    return steady_now + std::chrono::nanoseconds(next_due > now ? next_due - now : 0);
+}
+
+LossStats Debugger::loss_stats() const {
+    LossStats stats;
+    std::lock_guard lock(mutex_);
+    categories_.for_each([&](const Category& category) {
+        stats.dropped += category.dropped();
+        stats.overwritten += category.overwritten();
+    });
+    return stats;
+}
+
+DebuggerStats Debugger::stats() const {
+    DebuggerStats result;
+    result.taken = std::chrono::steady_clock::now();
+    
+    std::vector<uint64_t> messages;
+    std::vector<uint64_t> subitem_messages;
+    {
+        std::lock_guard lock(staging_mutex_);
+        messages = retired_messages_;
+        subitem_messages = retired_subitem_messages_;
+        result.enqueue_wait = retired_enqueue_wait_;
+        for (const auto& buffer : staging_buffers_) {
+            buffer->messages.accumulate(messages);
+            buffer->subitem_messages.accumulate(subitem_messages);
+            result.enqueue_wait.merge(buffer->enqueue_wait.snapshot());
+        }
+    }
+    
+    std::lock_guard lock(mutex_);
+    std::vector<LatencyHistogram> handler_time(categories_.size());
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+        const Lane& lane = *lanes_[i];
+        for (size_t id = 0; id < handler_time.size(); ++id) {
+            if (const HistogramCounter* counter = lane.handler_time.get(id)) {
+                handler_time[id].merge(counter->snapshot());
+            }
+        }
+        
+        // Lanes left over from an earlier init with more threads only
+        // contribute their history
+        LaneStats stats;
+        stats.index = i;
+        stats.queue_depth = static_cast<uint64_t>(std::max<int64_t>(lane.queued_records.load(), 0));
+        stats.high_water = static_cast<uint64_t>(lane.high_water.load());
+        stats.staged_batches = lane.staged_batches.load();
+        stats.dispatched = lane.dispatched.load();
+        stats.dispatch_lag = lane.dispatch_lag.snapshot();
+        stats.error_lag = lane.error_lag.snapshot();
+        stats.batch_time = lane.batch_time.snapshot();
+        result.dispatch_lag.merge(stats.dispatch_lag);
+        result.error_lag.merge(stats.error_lag);
+        if (i < num_lanes_) {
+            result.lanes.push_back(std::move(stats));
+        }
+    }
+    
+    categories_.for_each([&](const Category& category) {
+        const uint32_t id = category.id();
+        CategoryStats stats;
+        stats.messages = id < messages.size() ? messages[id] : 0;
+        stats.dropped = category.dropped();
+        stats.overwritten = category.overwritten();
+        stats.handler_time = handler_time[id];
+        if (auto it = throttles_.find(id); it != throttles_.end()) {
+            stats.collapsed = it->second->collapsed();
+            stats.suppressed = it->second->suppressed();
+        }
+        if (const Sampler* sampler = category.sampler()) {
+            stats.sample_probability = sampler->probability();
+        }
+        if (stats.messages == 0 && stats.handler_time.count == 0 && stats.dropped == 0
+            && stats.collapsed == 0 && stats.suppressed == 0) return;
+        stats.id = id;
+        stats.name = category.name();
+        result.categories.push_back(std::move(stats));
+    });
+    
+    for (size_t i = 0; i < subitem_info_.size(); ++i) {
+        const uint64_t index = i + 1;
+        const uint64_t count = index < subitem_messages.size() ? subitem_messages[index] : 0;
+        if (count == 0) continue;
+        const SubitemInfo& info = subitem_info_[i];
+        const Category* category = categories_.get(info.category);
+        result.subitems.push_back(SubitemStats{index, info.id, info.name,
+                                               category ? category->name() : std::string(), count});
+    }
+    return result;
+}
+
+void Debugger::publish_stats() {
+    // Runs on lane 0; rates are over the time since the last publication
+    if (!stats_category_->enabled()) return;
+    
+    DebuggerStats current = stats();
+    send_message(*stats_category_, "debugger stats",
+                 debugger::to_json(current, published_stats_ ? &*published_stats_ : nullptr));
+    published_stats_ = std::move(current);
+}
+
+Debugger::MetricInfo* Debugger::register_metric(const DebugSubitem& subitem, MetricKind kind,
+                                                std::string_view name) {
+    bool first = false;
+    MetricInfo* result = nullptr;
+    {
+        std::lock_guard lock(metrics_mutex_);
+        auto [it, created] = metric_groups_.try_emplace(subitem.index());
+        MetricGroup& group = it->second;
+        if (created) {
+            group.category = &subitem.category();
+            group.reported_at = RecordClock::now();
+        }
+        // Subitems have a handful of metrics, looked up once each
+        for (MetricInfo& metric : group.metrics) {
+            if (metric.name == name) return metric.kind == kind ? &metric : nullptr;
+        }
+        
+        const uint32_t slots = kind == MetricKind::counter ? 1
+                             : kind == MetricKind::histogram ? 1 + MetricBuckets::count : 0;
+        if (next_metric_slot_ + slots > CounterArray::chunk_size * CounterArray::max_chunks) return nullptr;
+        
+        result = &group.metrics.emplace_back();
+        result->name = name;
+        result->kind = kind;
+        if (slots > 0) {
+            result->slot = next_metric_slot_;
+            next_metric_slot_ += slots;
+        }
+        result->reported.assign(slots, 0);
+        first = !has_metrics_.exchange(true);
+    }
+    // Lane 0 may be asleep with no deadline
+    if (first && running_.load()) {
+        wake_lane(*lanes_[0]);
+    }
+    return result;
+}
+
+void Debugger::publish_metrics() {
+    // Runs on lane 0 and at shutdown. Per-thread counters are never reset:
+    // their totals are compared with those last sent
+    struct Summary {
+        const Category* category;
+        uint64_t subitem;
+        json data;
+    };
+    std::vector<Summary> summaries;
+    {
+        std::lock_guard lock(metrics_mutex_);
+        std::vector<uint64_t> totals;
+        {
+            std::lock_guard staging_lock(staging_mutex_);
+            totals = retired_metrics_;
+            for (const auto& buffer : staging_buffers_) {
+                buffer->metrics.accumulate(totals);
+            }
+        }
+        totals.resize(next_metric_slot_);
+        
+        const uint64_t now = RecordClock::now();
+        for (auto& [subitem, group] : metric_groups_) {
+            json counters = json::object();
+            json gauges = json::object();
+            json histograms = json::object();
+            for (MetricInfo& metric : group.metrics) {
+                switch (metric.kind) {
+                    case MetricKind::counter: {
+                        const uint64_t total = totals[metric.slot];
+                        if (total == metric.reported[0]) break;
+                        counters[metric.name] = {{"delta", total - metric.reported[0]}, {"total", total}};
+                        metric.reported[0] = total;
+                        break;
+                    }
+                    case MetricKind::gauge: {
+                        const double value = metric.gauge.load(std::memory_order_relaxed);
+                        if (metric.reported_gauge == value) break;
+                        gauges[metric.name] = value;
+                        metric.reported_gauge = value;
+                        break;
+                    }
+                    case MetricKind::histogram: {
+                        json summary = histogram_summary(totals.data() + metric.slot, metric.reported);
+                        if (!summary.is_null()) {
+                            histograms[metric.name] = std::move(summary);
+                        }
+                        break;
+                    }
+                }
+            }
+            if (counters.empty() && gauges.empty() && histograms.empty()) continue;
+            
+            json data = {{"interval", now - group.reported_at}};
+            group.reported_at = now;
+            if (!counters.empty()) data["counters"] = std::move(counters);
+            if (!gauges.empty()) data["gauges"] = std::move(gauges);
+            if (!histograms.empty()) data["histograms"] = std::move(histograms);
+            summaries.push_back({group.category, subitem, std::move(data)});
+        }
+    }
+    
+    // Sent like throttle reports, past sampling and throttling
+    const uint64_t now = RecordClock::now();
+    for (const auto& summary : summaries) {
+        if (!summary.category->enabled()) continue;
+        write_record(*summary.category, Level::info, summary.subitem, "metrics", now, 0, [&](RecordEncoder& encoder) {
+            encoder.add_flags(record_metrics);
+            encoder.add_data(summary.data);
         });
     }
-    cv_.notify_one();
+}
+
+Category& Debugger::intern_category(std::string_view name) {
+    std::lock_guard lock(mutex_);
+    return intern_locked(name);
+}
+
+Category& Debugger::intern_locked(std::string_view name) {
+    // Caller holds mutex_. New categories need no route slot: ids past the
+    // end of the route table simply have nothing registered, unless an
+    // existing pattern subscription already covers them
+    auto [category, created] = categories_.intern(name);
+    if (created && owned_flight_recorder_) {
+        owned_flight_recorder_->describe_category(category.id(), category.name());
+        category.set_enabled(true);
+    }
+    if (created && !subscriptions_.empty()) {
+        Route resolved;
+        resolve_subscribers(category, resolved);
+        if (!resolved.empty()) {
+            update_route(category, [&](Route& route) {
+                route.subscribers = std::move(resolved.subscribers);
+                route.batch_subscribers = std::move(resolved.batch_subscribers);
+            });
+        }
+    }
+    return category;
+}
+
+json Debugger::to_json(const RecordView& record) const {
+    json data = record.data();
+    
+    if (const SubitemInfo* subitem = subitem_table_.get(record.subitem())) {
+        // Raw data is kept under "data" rather than lost to the subitem's
+        // fields
+        if (data.is_null()) {
+            data = json::object();
+        } else if (!data.is_object()) {
+            data = json{{"data", std::move(data)}};
+        }
+        data["subitem_id"] = subitem->id;
+        data["subitem_name"] = subitem->name;
+        data["level"] = to_string(record.level());
+    }
+    if (record.sample_weight() != 1.0f && (data.is_object() || data.is_null())) {
+        data["sample_weight"] = record.sample_weight();
+    }
+    
+    return {
+        {"message", record.message()},
+        {"data", std::move(data)},
+        {"timestamp", record.timestamp()},
+        {"sequence", record.sequence()}
+    };
+}
+
+uint64_t Debugger::register_subitem(const std::string& id, const std::string& name, uint32_t category) {
+    std::lock_guard lock(mutex_);
+    auto& info = subitem_info_.emplace_back(SubitemInfo{id, name, category});
+    const uint64_t index = subitem_info_.size();
+    subitem_table_.set(index, &info);
+    if (owned_flight_recorder_) {
+        owned_flight_recorder_->describe_subitem(index, category, id, name);
+    }
+    return index;
+}
+
+bool Debugger::enable_flight_recorder(const FlightRecorderOptions& options) {
+    std::lock_guard lock(mutex_);
+    if (owned_flight_recorder_) return false;
+    
+    auto recorder = FlightRecorder::create(options);
+    if (!recorder) return false;
+    
+    // Name everything that exists so far; intern_locked and register_subitem
+    // take care of the rest
+    categories_.for_each([&](const Category& category) {
+        recorder->describe_category(category.id(), category.name());
+    });
+    for (size_t i = 0; i < subitem_info_.size(); ++i) {
+        const SubitemInfo& info = subitem_info_[i];
+        recorder->describe_subitem(i + 1, info.category, info.id, info.name);
+    }
+    
+    owned_flight_recorder_ = std::move(recorder);
+    flight_recorder_.store(owned_flight_recorder_.get(), std::memory_order_release);
+    categories_.for_each([](Category& category) {
+        category.set_enabled(true);
+    });
+    return true;
+}
+
+void Debugger::set_routed(Category& category, bool routed) {
+    // Caller holds mutex_. With a flight recorder every category stays
+    // enabled; routed only decides whether records are queued
+    category.set_routed(routed);
+    category.set_enabled(routed || owned_flight_recorder_ != nullptr);
+}
+
+Category& Debugger::resolve_category(const std::string& name) {
+    // Categories are never removed, so each thread can keep its own lookup
+    // table and avoid shared state after the first message per category
+    thread_local std::unordered_map<std::string, Category*> cache;
+    auto it = cache.find(name);
+    if (it != cache.end()) {
+        return *it->second;
+    }
+    
+    Category& category = intern_category(name);
+    cache.emplace(name, &category);
+    return category;
+}
+
+template<typename Fn>
+void Debugger::update_route(Category& category, Fn&& modify) {
+    // Caller holds mutex_
+    auto table = copy_routes();
+    if (table->size() <= category.id()) {
+        table->resize(category.id() + 1);
+    }
+    Route& route = (*table)[category.id()];
+    modify(route);
+    const bool routed = !route.empty();
+    
+    publish_routes(std::move(table));
+    set_routed(category, routed);
+}
+
+std::unique_ptr<Debugger::RouteTable> Debugger::copy_routes() const {
+    return current_routes_ ? std::make_unique<RouteTable>(*current_routes_)
+                           : std::make_unique<RouteTable>();
+}
+
+void Debugger::publish_routes(std::unique_ptr<RouteTable> table) {
+    // Caller holds mutex_. Lanes still reading the old table keep it alive
+    if (current_routes_) {
+        retired_routes_.push_back(std::move(current_routes_));
+    }
+    current_routes_ = std::move(table);
+    routes_.store(current_routes_.get(), std::memory_order_seq_cst);
+    
+    reclaim_routes();
+}
+
+void Debugger::resolve_subscribers(const Category& category, Route& route) const {
+    // Caller holds mutex_. Only subscribers with a callback count, so an
+    // idle subscriber does not enable its categories
+    std::vector<const Subscription*> matched;
+    subscriptions_.match(category.name(), [&](const Subscription& subscription) {
+        matched.push_back(&subscription);
+    });
+    std::sort(matched.begin(), matched.end(),
+              [](const Subscription* a, const Subscription* b) { return a->order < b->order; });
+    
+    route.subscribers.clear();
+    route.batch_subscribers.clear();
+    for (const Subscription* subscription : matched) {
+        if (auto callback = subscription->subscriber->callback()) {
+            route.subscribers.push_back(std::move(callback));
+        } else if (auto sink = subscription->subscriber->batch_sink()) {
+            route.batch_subscribers.push_back(std::move(sink));
+        }
+    }
+}
+
+void Debugger::refresh_subscribers(std::string_view pattern) {
+    // Caller holds mutex_. Re-resolve every known category the pattern
+    // covers and publish them together in one snapshot
+    auto table = copy_routes();
+    std::vector<Category*> touched;
+    categories_.for_each([&](Category& category) {
+        if (!TopicTrie<Subscription>::matches(pattern, category.name())) return;
+        if (table->size() <= category.id()) {
+            table->resize(category.id() + 1);
+        }
+        resolve_subscribers(category, (*table)[category.id()]);
+        touched.push_back(&category);
+    });
+    if (touched.empty()) return;
+    
+    publish_routes(std::move(table));
+    for (Category* category : touched) {
+        set_routed(*category, !(*current_routes_)[category->id()].empty());
+    }
+}
+
+void Debugger::reclaim_routes() {
+    // Caller holds mutex_. The seq_cst publish in update_route and the
+    // seq_cst hazard store in acquire_routes guarantee that a lane either
+    // announced the old table before we look, or will see the new one
+    std::erase_if(retired_routes_, [this](const std::unique_ptr<const RouteTable>& table) {
+        for (const auto& lane : lanes_) {
+            if (lane->hazard.load(std::memory_order_seq_cst) == table.get()) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+const Debugger::RouteTable& Debugger::acquire_routes(Lane& lane) {
+    // Nested dispatch on the same lane (a handler that drains inline) keeps
+    // using the table the outer call already protected
+    if (lane.route_depth++ > 0) {
+        return *lane.routes_in_use;
+    }
+    
+    static const RouteTable empty;
+    const RouteTable* table = routes_.load(std::memory_order_seq_cst);
+    for (;;) {
+        lane.hazard.store(table, std::memory_order_seq_cst);
+        const RouteTable* current = routes_.load(std::memory_order_seq_cst);
+        if (current == table) break;
+        table = current;
+    }
+    lane.routes_in_use = table ? table : &empty;
+    return *lane.routes_in_use;
+}
+
+void Debugger::release_routes(Lane& lane) {
+    if (--lane.route_depth == 0) {
+        lane.routes_in_use = nullptr;
+        lane.hazard.store(nullptr, std::memory_order_release);
+    }
 }
 
 void Debugger::register_handler(const std::string& category, MessageHandler handler) {
+    auto shared = std::make_shared<const MessageHandler>(std::move(handler));
+    std::lock_guard lock(mutex_);
+    update_route(intern_locked(category), [&](Route& route) {
+        route.handler = std::move(shared);
+    });
+}
+
+void Debugger::register_record_handler(const std::string& category, RecordHandler handler) {
+    auto shared = std::make_shared<const RecordHandler>(std::move(handler));
     std::lock_guard lock(mutex_);
-    handlers_[category] = std::move(handler);
+    update_route(intern_locked(category), [&](Route& route) {
+        route.record_handler = std::move(shared);
+    });
 }
 
-std::shared_ptr<DebugSubscriber> Debugger::create_subscriber(const std::string& category) {
+void Debugger::register_batch_handler(const std::string& category, BatchHandler handler, BatchOptions options) {
+    auto shared = std::make_shared<const BatchSink>(BatchSink{std::move(handler), options});
     std::lock_guard lock(mutex_);
-    auto it = subscribers_.find(category);
-    if (it != subscribers_.end()) {
-        return it->second;
+    update_route(intern_locked(category), [&](Route& route) {
+        route.batch_handler = std::move(shared);
+    });
+}
+
+std::shared_ptr<DebugSubscriber> Debugger::create_subscriber(const std::string& pattern) {
+    auto subscriber = std::make_shared<DebugSubscriber>(pattern);
+    {
+        std::lock_guard lock(mutex_);
+        subscriptions_.insert(pattern, Subscription{next_subscription_++, subscriber});
     }
     
-    auto subscriber = std::make_shared<DebugSubscriber>(category);
-    subscribers_[category] = subscriber;
+    // Resolved lists are rebuilt whenever the subscriber subscribes or
+    // unsubscribes; until then it is not counted as interest
+    subscriber->set_change_listener([this, pattern] {
+        std::lock_guard lock(mutex_);
+        refresh_subscribers(pattern);
+    });
+    return subscriber;
+}
+
+std::shared_ptr<DebugSubscriber> Debugger::add_sink(const std::string& pattern, std::shared_ptr<Sink> sink,
+                                                     BatchOptions options) {
+    auto subscriber = create_subscriber(pattern);
+    subscriber->subscribe_records([sink = std::move(sink)](std::span<const RecordView> records, const BatchInfo& info) {
+        sink->write(records, info);
+    }, options);
     return subscriber;
 }
 
 std::shared_ptr<DebugSubscriber> Debugger::get_subscriber(const std::string& name) {
     std::lock_guard lock(mutex_);
-    auto it = subscribers_.find(name);
-    return it != subscribers_.end() ? it->second : nullptr;
+    const auto* subscriptions = subscriptions_.find(name);
+    return subscriptions ? subscriptions->front().subscriber : nullptr;
 }
 
-std::shared_ptr<DebugSubitem> Debugger::create_subitem(const std::string& name, const std::string& parent_category) {
+void Debugger::remove_subscriber(const std::shared_ptr<DebugSubscriber>& subscriber) {
+    if (!subscriber) return;
+    
     std::lock_guard lock(mutex_);
+    const size_t removed = subscriptions_.erase_if(subscriber->category(), [&](const Subscription& subscription) {
+        return subscription.subscriber == subscriber;
+    });
+    if (removed == 0) return;
     
+    subscriber->set_change_listener(nullptr);
+    refresh_subscribers(subscriber->category());
+}
+
+std::shared_ptr<DebugSubitem> Debugger::create_subitem(const std::string& name, const std::string& parent_category) {
     std::string key = parent_category.empty() ? name : parent_category + "." + name;
-    auto it = subitems_.find(key);
-    if (it != subitems_.end()) {
-        return it->second;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = subitems_.find(key);
+        if (it != subitems_.end()) {
+            return it->second;
+        }
     }
     
+    // Constructed unlocked because the subitem interns its category
     auto subitem = std::make_shared<DebugSubitem>(name, parent_category);
-    subitems_[key] = subitem;
-    return subitem;
+    
+    std::lock_guard lock(mutex_);
+    auto [it, inserted] = subitems_.emplace(std::move(key), std::move(subitem));
+    return it->second;
 }
 
 std::vector<std::shared_ptr<DebugSubitem>> Debugger::get_all_subitems() const {
@@ -176,38 +910,863 @@ std::vector<std::shared_ptr<DebugSubitem>> Debugger::get_all_subitems() const {
     return result;
 }
 
-void Debugger::process_messages() {
-    std::unique_lock lock(mutex_);
-    while (!message_queue_.empty()) {
-        auto msg = std::move(message_queue_.front());
-        message_queue_.pop();
+void Debugger::prepare_lanes(const Options& options) {
+    staging_capacity_ = std::max<size_t>(options.staging_capacity, 1);
+    staging_max_age_ = options.staging_max_age;
+    overflow_policy_ = options.overflow_policy;
+    sample_every_ = std::max<uint32_t>(options.sample_every, 1);
+    priority_lanes_ = options.priority_lanes;
+    for (size_t level = 0; level < level_count; ++level) {
+        // A level with no weight would never be dispatched under load
+        level_shares_[level] = static_cast<int64_t>(std::max<uint32_t>(options.level_weights[level], 1)
+                                                    * staging_capacity_);
+    }
+    error_latency_ = options.error_latency;
+    num_lanes_ = std::max<size_t>(options.num_threads, 1);
+    collect_stats_ = options.collect_stats;
+    stats_interval_ = options.stats_interval;
+    stats_category_ = options.stats_interval.count() > 0 ? &intern_category(stats_category) : nullptr;
+    next_stats_ = std::chrono::steady_clock::now() + stats_interval_;
+    published_stats_.reset();
+    metrics_interval_ = options.metrics_interval;
+    next_metrics_ = std::chrono::steady_clock::now() + metrics_interval_;
+    
+    // Once per process, and before any lane runs, rather than in the
+    // first record's now()
+    RecordClock::calibrate();
+    next_recalibration_ = std::chrono::steady_clock::now() + clock_recalibration_interval;
+
+    // Each ring holds whole batches, so size it to cover queue_capacity
+    // messages. Error batches are handed off once error_latency old and
+    // mostly hold a record or two, so the error ring holds queue_capacity
+    // batches instead, up to max_error_batches. Queues are only replaced
+    // when their capacity changes.
+    const size_t batches = (options.queue_capacity + staging_capacity_ - 1) / staging_capacity_;
+    const size_t capacity = std::bit_ceil(std::max<size_t>(batches, 2));
+    const size_t error_capacity = priority_lanes_
+        ? std::bit_ceil(std::max(capacity, std::min(options.queue_capacity, max_error_batches)))
+        : capacity;
+    
+    {
+        // reclaim_routes walks lanes_ under mutex_
+        std::lock_guard lock(mutex_);
+        while (lanes_.size() < num_lanes_) {
+            lanes_.push_back(std::make_unique<Lane>());
+        }
+    }
+    for (size_t i = 0; i < num_lanes_; ++i) {
+        Lane& lane = *lanes_[i];
+        lane.index = i;
+        lane.exited.store(false);
+        {
+            std::lock_guard lock(lane.wake_mutex);
+            lane.accepting_flushes = true;
+        }
+        for (size_t level = 0; level < level_count; ++level) {
+            LevelQueues& queues = lane.levels[level];
+            const size_t size = level == error_queue ? error_capacity : capacity;
+            if (!queues.queue || queues.queue->capacity() != size) {
+                queues.queue = std::make_unique<MpmcRing<Batch*>>(size);
+                queues.overwrite_queue = std::make_unique<MpmcRing<Batch*>>(size);
+            }
+        }
+        lane.credit = level_shares_;
+        lane.errors_waiting = {};
+    }
+}
+
+size_t Debugger::lane_for(uint32_t category) const {
+    // Fibonacci hashing spreads neighbouring ids across lanes
+    const uint64_t hash = (uint64_t{category} + 1) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((hash >> 32) % num_lanes_);
+}
+
+size_t Debugger::slot_for(const Category& category, Level level) const {
+    const auto policy = category.overflow_policy().value_or(overflow_policy_);
+    const size_t queue = priority_lanes_ ? static_cast<size_t>(level) : 0;
+    return (lane_for(category.id()) * level_count + queue) * policy_count + static_cast<size_t>(policy);
+}
+
+void Debugger::run_lane(size_t index) {
+    Lane& lane = *lanes_[index];
+    dispatcher_lane = index;
+    
+    for (;;) {
+        drain_lane(lane);
+        
+        if (!running_.load()) {
+            // Flush every thread's leftovers for this lane and drain
+            // anything enqueued while we were shutting down
+            sweep_staging_buffers(index, true);
+            drain_lane(lane);
+            
+            // A producer past the running_ check may still hand off. From
+            // here on it discards what it pushes; what it pushed before it
+            // could see exited is drained below
+            lane.exited.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            drain_lane(lane);
+            flush_batches(lane, true);
+            complete_flushes(lane, true);
+            break;
+        }
+        
+        if (lane.flush_requested.load(std::memory_order_acquire)) [[unlikely]] {
+            complete_flushes(lane, false);
+        }
         
-        // Release the lock while processing the message
-        lock.unlock();
-        process_message(msg);
-        lock.lock();
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lane.last_sweep >= staging_max_age_ / 2) {
+            lane.last_sweep = now;
+            lane.last_error_sweep = now;
+            sweep_staging_buffers(index, false);
+            drain_lane(lane);
+        } else if (lane.staged_errors.load(std::memory_order_relaxed) > 0) {
+            sweep_errors(lane, now);
+            drain_lane(lane);
+        }
+        
+        if (index == 0 && has_throttles_.load(std::memory_order_relaxed) && now >= throttle_deadline_) {
+            throttle_deadline_ = std::min(flush_throttles(false), now + throttle_poll_interval);
+        }
+        
+        if (index == 0 && stats_category_ && now >= next_stats_) {
+            next_stats_ = now + stats_interval_;
+            publish_stats();
+        }
+        
+        const bool publishes_metrics = index == 0 && metrics_interval_.count() > 0
+                                    && has_metrics_.load(std::memory_order_relaxed);
+        if (publishes_metrics && now >= next_metrics_) {
+            next_metrics_ = now + metrics_interval_;
+            publish_metrics();
+        }
+        
+        const bool recalibrates = index == 0 && RecordClock::uses_tsc();
+        if (recalibrates && now >= next_recalibration_) {
+            next_recalibration_ = now + clock_recalibration_interval;
+            RecordClock::recalibrate();
+        }
+        
+        std::unique_lock lock(lane.wake_mutex);
+        lane.idle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (lane_empty(lane) && running_.load() && !lane.flush_requested.load(std::memory_order_relaxed)) {
+            // Come back when partially filled staging buffers go stale or a
+            // lingering batch is due, whichever is first
+            auto deadline = std::chrono::steady_clock::time_point::max();
+            if (lane.staged_errors.load(std::memory_order_relaxed) > 0) {
+                deadline = now + error_latency_ / 2;
+            } else if (lane.staged_batches.load(std::memory_order_relaxed) > 0) {
+                deadline = now + staging_max_age_;
+            }
+            for (const auto& [sink, batch] : lane.pending_batches) {
+                deadline = std::min(deadline, batch.opened + batch.sink->options.max_linger);
+            }
+            if (index == 0 && stats_category_) {
+                deadline = std::min(deadline, next_stats_);
+            }
+            if (publishes_metrics) {
+                deadline = std::min(deadline, next_metrics_);
+            }
+            if (recalibrates) {
+                deadline = std::min(deadline, next_recalibration_);
+            }
+            if (index == 0 && has_throttles_.load(std::memory_order_relaxed)) {
+                deadline = std::min(deadline, throttle_deadline_);
+            }
+            
+            if (deadline != std::chrono::steady_clock::time_point::max()) {
+                lane.cv.wait_until(lock, deadline);
+            } else {
+                lane.cv.wait(lock, [&] {
+                    return !lane_empty(lane) || !running_.load()
+                        || lane.staged_batches.load(std::memory_order_relaxed) > 0
+                        || lane.flush_requested.load(std::memory_order_relaxed)
+                        || (index == 0 && metrics_interval_.count() > 0
+                            && has_metrics_.load(std::memory_order_relaxed));
+                });
+            }
+        }
+        lane.idle.store(false, std::memory_order_relaxed);
     }
+    
+    dispatcher_lane = no_lane;
+    active_loops_.fetch_sub(1);
+    active_loops_.notify_all();
 }
 
-void Debugger::process_message(const Message& msg) {
-    // First, check for a direct handler
+void Debugger::wake_lane(Lane& lane) {
     {
-        std::lock_guard lock(mutex_);
-        auto it = handlers_.find(msg.category);
-        if (it != handlers_.end()) {
-            it->second(msg.data);
+        std::lock_guard lock(lane.wake_mutex);
+    }
+    lane.cv.notify_all();
+}
+
+void request_flush(FlushWaiter& waiter, const Category* category) {
+    Debugger::instance().request_flush(waiter, category);
+}
+
+void Debugger::request_flush(FlushWaiter& waiter, const Category* category) {
+    size_t first = 0;
+    size_t last = num_lanes_;
+    if (category && last > 0) {
+        first = lane_for(category->id());
+        last = first + 1;
+    }
+    
+    // The extra count keeps the waiter from completing while it is still
+    // being handed out
+    waiter.remaining.store(last - first + 1, std::memory_order_relaxed);
+    for (size_t i = first; i < last; ++i) {
+        Lane& lane = *lanes_[i];
+        bool queued = false;
+        {
+            std::lock_guard lock(lane.wake_mutex);
+            if (lane.accepting_flushes) {
+                lane.flush_waiters.push_back(&waiter);
+                lane.flush_requested.store(true, std::memory_order_release);
+                queued = true;
+            }
+        }
+        if (queued) {
+            lane.cv.notify_all();
+        } else {
+            // Stopped lanes have nothing left to deliver
+            release_flush(waiter);
+        }
+    }
+    release_flush(waiter);
+}
+
+void Debugger::complete_flushes(Lane& lane, bool closing) {
+    // Swapping hands the emptied vector back, so neither ever shrinks
+    std::vector<FlushWaiter*>& waiters = lane.completing_flushes;
+    {
+        std::lock_guard lock(lane.wake_mutex);
+        waiters.swap(lane.flush_waiters);
+        lane.flush_requested.store(false, std::memory_order_relaxed);
+        if (closing) {
+            lane.accepting_flushes = false;
+        }
+    }
+    
+    if (!closing) {
+        // Records staged before the waiters arrived may still sit in other
+        // threads' staging buffers or in lingering sink batches
+        sweep_staging_buffers(lane.index, true);
+        drain_lane(lane);
+        flush_batches(lane, true);
+    }
+    for (FlushWaiter* waiter : waiters) {
+        release_flush(*waiter);
+    }
+    waiters.clear();
+}
+
+void Debugger::wake_all_lanes() {
+    for (size_t i = 0; i < num_lanes_; ++i) {
+        wake_lane(*lanes_[i]);
+    }
+}
+
+void Debugger::drain_lane(Lane& lane) {
+    // Deficit round robin over the levels, errors first: each round a
+    // level may dispatch its share of records, and one with nothing waiting
+    // keeps no more than a round's share, so it cannot save up a burst. A
+    // category only ever stages into one of a level's two rings (unless its
+    // policy changes), so draining them in turn keeps the level in order.
+    Batch* batch = nullptr;
+    for (bool waiting = true; waiting;) {
+        waiting = false;
+        for (size_t level = level_count; level-- > 0;) {
+            LevelQueues& queues = lane.levels[level];
+            lane.credit[level] = std::min(lane.credit[level] + level_shares_[level], level_shares_[level]);
+            while (lane.credit[level] > 0 && queues.try_pop(batch)) {
+                lane.credit[level] -= static_cast<int64_t>(batch->count);
+                count_queued(lane, -static_cast<int64_t>(batch->count));
+                process_batch(lane, batch, priority_lanes_ && level != error_queue);
+            }
+            if (!queues.empty()) {
+                waiting = true;
+            } else if (level == error_queue) {
+                lane.errors_waiting = {};
+            }
+        }
+    }
+    
+    // Everything drained in this pass goes out as one batch per sink
+    flush_batches(lane, false);
+    release_batches(lane);
+}
+
+void Debugger::sweep_errors(Lane& lane, std::chrono::steady_clock::time_point now) {
+    // Staged errors of every thread, once they are error_latency old
+    if (now - lane.last_error_sweep < error_latency_ / 2) return;
+    lane.last_error_sweep = now;
+    sweep_staging_buffers(lane.index, false, true);
+}
+
+void Debugger::take_errors(Lane& lane) {
+    // Between two records of a lower level, with errors staged or waiting.
+    // Staged ones are swept out when due, so a flood that keeps the lane
+    // from idling does not hold them back. Queued ones within this round's
+    // share go at once, the rest once they have waited error_latency, with
+    // the next round's share taken early
+    const auto now = std::chrono::steady_clock::now();
+    if (lane.staged_errors.load(std::memory_order_relaxed) > 0) {
+        sweep_errors(lane, now);
+    }
+    LevelQueues& errors = lane.levels[error_queue];
+    if (errors.empty()) return;
+    
+    if (lane.credit[error_queue] <= 0) {
+        if (lane.errors_waiting == std::chrono::steady_clock::time_point{}) {
+            lane.errors_waiting = now;
+            return;
+        }
+        if (now - lane.errors_waiting < error_latency_) return;
+        lane.credit[error_queue] += level_shares_[error_queue];
+    }
+    lane.errors_waiting = {};
+    
+    lane.taking_errors = true;
+    Batch* batch = nullptr;
+    while (lane.credit[error_queue] > 0 && errors.try_pop(batch)) {
+        lane.credit[error_queue] -= static_cast<int64_t>(batch->count);
+        count_queued(lane, -static_cast<int64_t>(batch->count));
+        process_batch(lane, batch);
+    }
+    lane.taking_errors = false;
+}
+
+bool Debugger::lane_empty(const Lane& lane) {
+    return std::all_of(lane.levels.begin(), lane.levels.end(), [](const LevelQueues& queues) {
+        return queues.empty();
+    });
+}
+
+void Debugger::process_batch(Lane& lane, Batch* batch, bool yields_to_errors) {
+    // One snapshot covers the whole batch; registration changes made while
+    // it is processed apply from the next batch on
+    const RouteTable& routes = acquire_routes(lane);
+    const LevelQueues& errors = lane.levels[error_queue];
+    const bool yields = yields_to_errors && !lane.taking_errors;
+    if (collect_stats_) {
+        // One clock read per record: it ends this record's handler time and
+        // starts the next record's lag
+        uint64_t start = RecordClock::now();
+        for_each_record(batch->bytes.data(), batch->bytes.size(), [&](const RecordView& record) {
+            const uint64_t lag = start > record.timestamp() ? start - record.timestamp() : 0;
+            lane.dispatch_lag.record(lag);
+            if (record.level() == Level::error) {
+                lane.error_lag.record(lag);
+            }
+            process_record(lane, routes, record);
+            const uint64_t end = RecordClock::now();
+            handler_time(lane, record.category_id()).record(end > start ? end - start : 0);
+            start = end;
+            if (yields && (!errors.empty() || lane.staged_errors.load(std::memory_order_relaxed) > 0)) [[unlikely]] {
+                take_errors(lane);
+                start = RecordClock::now();
+            }
+        });
+        lane.dispatched.store(lane.dispatched.load(std::memory_order_relaxed) + batch->count,
+                              std::memory_order_relaxed);
+    } else {
+        for_each_record(batch->bytes.data(), batch->bytes.size(), [&](const RecordView& record) {
+            process_record(lane, routes, record);
+            if (yields && (!errors.empty() || lane.staged_errors.load(std::memory_order_relaxed) > 0)) [[unlikely]] {
+                take_errors(lane);
+            }
+        });
+    }
+    release_routes(lane);
+    batch->bytes.clear();
+    batch->count = 0;
+    lane.free_batches.push_back(batch);
+}
+
+void Debugger::process_record(Lane& lane, const RouteTable& routes, const RecordView& record) {
+    // One indexed lookup finds everything routed to the record's category;
+    // no lock is held while callbacks run, so they may log or register
+    if (record.category_id() >= routes.size()) return;
+    const Route& route = routes[record.category_id()];
+    
+    if (route.record_handler) {
+        (*route.record_handler)(record);
+    }
+    if (route.batch_handler) {
+        collect_record(lane, route.batch_handler, record);
+    }
+    for (const auto& sink : route.batch_subscribers) {
+        collect_record(lane, sink, record);
+    }
+    
+    // json is only built if a json handler or subscriber wants it, and
+    // then shared by all of them
+    if (route.handler || !route.subscribers.empty()) {
+        const json message = to_json(record);
+        if (route.handler) {
+            (*route.handler)(message);
+        }
+        for (const auto& subscriber : route.subscribers) {
+            (*subscriber)(message);
+        }
+    }
+}
+
+void Debugger::collect_record(Lane& lane, const std::shared_ptr<const BatchSink>& sink, const RecordView& record) {
+    // The record's own batch is recycled after this pass, so copy it
+    auto it = lane.pending_batches.find(sink.get());
+    if (it == lane.pending_batches.end()) {
+        if (!lane.spare_batches.empty()) {
+            PendingNode node = std::move(lane.spare_batches.back());
+            lane.spare_batches.pop_back();
+            node.key() = sink.get();
+            it = lane.pending_batches.insert(std::move(node)).position;
+        } else {
+            it = lane.pending_batches.try_emplace(sink.get()).first;
         }
+        it->second.sink = sink;
+        it->second.opened = std::chrono::steady_clock::now();
     }
+    PendingBatch& pending = it->second;
+    pending.bytes.insert(pending.bytes.end(), record.bytes(), record.bytes() + record.size());
+    ++pending.count;
     
-    // Then notify subscribers
-    auto sub = get_subscriber(msg.category);
-    if (sub) {
-        sub->deliver(msg.data);
+    if (pending.count >= sink->options.max_batch_size) {
+        PendingNode full = lane.pending_batches.extract(it);
+        deliver_batch(lane, full.mapped());
+        lane.spare_batches.push_back(std::move(full));
     }
 }
 
+void Debugger::flush_batches(Lane& lane, bool force) {
+    if (lane.pending_batches.empty()) return;
+    
+    // Take the due batches out first: a handler may log, which can drain
+    // this lane again and collect into pending_batches while we deliver
+    const auto now = std::chrono::steady_clock::now();
+    const size_t first = lane.due_batches.size();
+    for (auto it = lane.pending_batches.begin(); it != lane.pending_batches.end();) {
+        const PendingBatch& pending = it->second;
+        if (force || now - pending.opened >= pending.sink->options.max_linger) {
+            const auto next = std::next(it);
+            lane.due_batches.push_back(lane.pending_batches.extract(it));
+            it = next;
+        } else {
+            ++it;
+        }
+    }
+    
+    // A nested call appends behind ours and trims back before returning
+    const size_t last = lane.due_batches.size();
+    for (size_t i = first; i < last; ++i) {
+        PendingNode node = std::move(lane.due_batches[i]);
+        deliver_batch(lane, node.mapped());
+        lane.spare_batches.push_back(std::move(node));
+    }
+    lane.due_batches.resize(first);
+}
+
+void Debugger::deliver_batch(Lane& lane, PendingBatch& batch) {
+    // The handler still reads the views, so a nested delivery builds its own
+    std::vector<RecordView> nested;
+    const bool outermost = !lane.delivering;
+    std::vector<RecordView>& records = outermost ? lane.record_views : nested;
+    lane.delivering = true;
+    records.clear();
+    records.reserve(batch.count);
+    for_each_record(batch.bytes.data(), batch.bytes.size(), [&](const RecordView& record) {
+        records.push_back(record);
+    });
+    
+    if (!records.empty()) {
+        const BatchInfo info{lane.index, records.front().timestamp(), records.back().timestamp(),
+                             batch.bytes.size()};
+        const auto start = std::chrono::steady_clock::now();
+        batch.sink->handler(records, info);
+        if (collect_stats_) {
+            lane.batch_time.record(static_cast<uint64_t>(
+                std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count()));
+        }
+    }
+    
+    if (outermost) {
+        lane.delivering = false;
+    }
+    batch.bytes.clear();
+    batch.count = 0;
+    batch.sink.reset();
+}
+
+Debugger::StagingBuffer& Debugger::local_staging_buffer() {
+    // Registers the calling thread's buffer on first use and hands its
+    // leftovers to the dispatcher when the thread exits
+    struct Slot {
+        std::shared_ptr<StagingBuffer> buffer;
+        ~Slot() {
+            if (buffer) {
+                Debugger::instance().retire_staging_buffer(buffer);
+            }
+        }
+    };
+    thread_local Slot slot;
+    
+    if (!slot.buffer) {
+        slot.buffer = std::make_shared<StagingBuffer>();
+        std::lock_guard lock(staging_mutex_);
+        staging_buffers_.push_back(slot.buffer);
+    }
+    return *slot.buffer;
+}
+
+Debugger::Stage& Debugger::open_record(StagingBuffer& buffer, size_t slot) {
+    // Caller holds buffer.mutex
+    if (buffer.stages.size() < lanes_.size() * slots_per_lane) {
+        buffer.stages.resize(lanes_.size() * slots_per_lane);
+    }
+    
+    Stage& stage = buffer.stages[slot];
+    if (!stage.batch) {
+        stage.batch = acquire_batch();
+        stage.opened = std::chrono::steady_clock::now();
+        stage.fresh = true;
+        Lane& target = *lanes_[slot / slots_per_lane];
+        target.staged_batches.fetch_add(1);
+        if (error_slot(slot)) {
+            target.staged_errors.fetch_add(1);
+        }
+    }
+    return stage;
+}
+
+void Debugger::stage_loss_report(Stage& stage, const Category& category, uint64_t timestamp) {
+    // Caller holds the buffer lock. Staged just ahead of the category's next
+    // record, so handlers see the gap close to where it happened
+    const uint64_t lost = category.take_unreported();
+    if (lost == 0) return;
+    
+    RecordEncoder encoder(stage.batch->bytes, category.id(), Level::warning, 0, timestamp,
+                          std::to_string(lost) + " messages lost");
+    encoder.add_flags(record_loss_report);
+    encoder.set_sequence(next_sequence_.fetch_add(1, std::memory_order_relaxed));
+    encoder.add("lost", lost);
+    encoder.finish();
+    ++stage.batch->count;
+}
+
+void Debugger::close_record(StagingBuffer& buffer, size_t slot) {
+    // Caller holds buffer.mutex
+    Stage& stage = buffer.stages[slot];
+    const bool fresh = std::exchange(stage.fresh, false);
+    ++stage.batch->count;
+    
+    // Errors wait for company no longer than error_latency
+    const auto max_age = error_slot(slot) ? error_latency_ : staging_max_age_;
+    if (stage.batch->count >= staging_capacity_
+        || std::chrono::steady_clock::now() - stage.opened >= max_age) {
+        hand_off(buffer, slot);
+    } else if (fresh) {
+        // Make sure an idle lane switches to a timed wait so this batch is
+        // swept once it goes stale
+        Lane& target = *lanes_[slot / slots_per_lane];
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (target.idle.load(std::memory_order_relaxed)) {
+            wake_lane(target);
+        }
+    }
+}
+
+void Debugger::hand_off(StagingBuffer& buffer, size_t slot) {
+    // Caller holds buffer.mutex
+    const size_t lane = slot / slots_per_lane;
+    const auto policy = static_cast<OverflowPolicy>(slot % policy_count);
+    Lane& target = *lanes_[lane];
+    LevelQueues& queues = target.levels[slot / policy_count % level_count];
+    Batch* batch = std::exchange(buffer.stages[slot].batch, nullptr);
+    target.staged_batches.fetch_sub(1);
+    if (error_slot(slot)) {
+        target.staged_errors.fetch_sub(1);
+    }
+    
+    switch (policy) {
+        case OverflowPolicy::block: {
+            const auto waited = push_blocking(*queues.queue, lane, batch);
+            if (waited.count() > 0 && collect_stats_) {
+                buffer.enqueue_wait.record(static_cast<uint64_t>(waited.count()));
+            }
+            break;
+        }
+        case OverflowPolicy::drop_newest: {
+            // Read before the push; once queued the lane may recycle it
+            const auto count = static_cast<int64_t>(batch->count);
+            if (!queues.queue->try_push(batch)) {
+                discard_batch(batch, false);
+                return;
+            }
+            count_queued(target, count);
+            break;
+        }
+        case OverflowPolicy::drop_oldest:
+        case OverflowPolicy::sample:
+            push_overwriting(target, *queues.overwrite_queue, policy, batch);
+            break;
+    }
+    
+    // Pairs with the fences in run_lane so either we see the lane going
+    // idle (or gone) or it sees our batch
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (target.exited.load(std::memory_order_relaxed)) [[unlikely]] {
+        discard_stranded(target);
+    } else if (target.idle.load(std::memory_order_relaxed)) {
+        wake_lane(target);
+    }
+}
+
+std::chrono::nanoseconds Debugger::push_blocking(MpmcRing<Batch*>& queue, size_t lane, Batch* batch) {
+    // Full queue: wait for the lane to make room rather than dropping. A
+    // dispatcher cannot wait on its own queue, so it drains that itself and
+    // then delivers the batch inline; while waiting on another lane it keeps
+    // draining its own so two lanes logging to each other cannot deadlock.
+    // Returns how long the wait took.
+    Lane& target = *lanes_[lane];
+    const auto count = static_cast<int64_t>(batch->count);
+    std::optional<std::chrono::steady_clock::time_point> waiting;
+    while (!queue.try_push(batch)) {
+        if (!waiting) {
+            waiting = std::chrono::steady_clock::now();
+        }
+        if (dispatcher_lane == lane) {
+            drain_lane(target);
+            process_batch(target, batch);
+            return std::chrono::steady_clock::now() - *waiting;
+        }
+        if (target.exited.load()) {
+            // Nothing will make room again after shutdown
+            discard_batch(batch, false);
+            return std::chrono::steady_clock::now() - *waiting;
+        }
+        if (dispatcher_lane != no_lane) {
+            drain_lane(*lanes_[dispatcher_lane]);
+        }
+        wake_lane(target);
+        std::this_thread::yield();
+    }
+    count_queued(target, count);
+    return waiting ? std::chrono::steady_clock::now() - *waiting : std::chrono::nanoseconds(0);
+}
+
+void Debugger::push_overwriting(Lane& lane, MpmcRing<Batch*>& queue, OverflowPolicy policy, Batch* batch) {
+    // Full queue: evict the oldest batch until ours fits. Sampling first
+    // thins our batch so only a fraction of the overflow displaces old data
+    bool thinned = false;
+    for (;;) {
+        const auto count = static_cast<int64_t>(batch->count);
+        if (queue.try_push(batch)) {
+            count_queued(lane, count);
+            return;
+        }
+        if (policy == OverflowPolicy::sample && !thinned) {
+            thinned = true;
+            thin_batch(*batch);
+            if (batch->count == 0) {
+                recycle_batch(batch);
+                return;
+            }
+            continue;
+        }
+        
+        Batch* oldest = nullptr;
+        if (queue.try_pop(oldest)) {
+            count_queued(lane, -static_cast<int64_t>(oldest->count));
+            discard_batch(oldest, true);
+        }
+    }
+}
+
+void Debugger::count_queued(Lane& lane, int64_t records) {
+    if (!collect_stats_) return;
+    const int64_t depth = lane.queued_records.fetch_add(records, std::memory_order_relaxed) + records;
+    int64_t high = lane.high_water.load(std::memory_order_relaxed);
+    while (depth > high && !lane.high_water.compare_exchange_weak(high, depth, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramCounter& Debugger::handler_time(Lane& lane, uint32_t category) {
+    // Only the lane's thread adds entries; stats() reads them through the table
+    HistogramCounter* counter = lane.handler_time.get(category);
+    if (!counter) [[unlikely]] {
+        counter = &lane.handler_time_storage.emplace_back();
+        lane.handler_time.set(category, counter);
+    }
+    return *counter;
+}
+
+void Debugger::thin_batch(Batch& batch) {
+    // Keep one record in sample_every_ per category, plus any loss reports,
+    // compacting the survivors towards the front of the buffer
+    std::byte* data = batch.bytes.data();
+    size_t read = 0;
+    size_t write = 0;
+    size_t kept = 0;
+    while (read + sizeof(RecordHeader) <= batch.bytes.size()) {
+        const RecordView record(data + read);
+        const size_t size = record.size();
+        const Category* category = categories_.get(record.category_id());
+        
+        if (record.loss_report() || category->next_overflow() % sample_every_ == 0) {
+            if (write != read) {
+                std::memmove(data + write, data + read, size);
+            }
+            write += size;
+            ++kept;
+        } else {
+            category->count_dropped(1);
+        }
+        read += size;
+    }
+    batch.bytes.resize(write);
+    batch.count = kept;
+}
+
+void Debugger::discard_batch(Batch* batch, bool overwritten) {
+    // Count every lost record against its category. A lost loss report
+    // hands its count back so the next report still covers it
+    for_each_record(batch->bytes.data(), batch->bytes.size(), [&](const RecordView& record) {
+        const Category* category = categories_.get(record.category_id());
+        if (record.loss_report()) {
+            record.for_each_field([&](const FieldView& field) {
+                if (field.key() == "lost") category->defer_report(field.as_uint());
+            });
+        } else if (overwritten) {
+            category->count_overwritten(1);
+        } else {
+            category->count_dropped(1);
+        }
+    });
+    recycle_batch(batch);
+}
+
+void Debugger::discard_stranded(Lane& lane) {
+    // The lane has exited, so nothing else drains its rings; any thread
+    // that finds batches there counts them as dropped
+    for (LevelQueues& queues : lane.levels) {
+        Batch* batch = nullptr;
+        while (queues.try_pop(batch)) {
+            count_queued(lane, -static_cast<int64_t>(batch->count));
+            discard_batch(batch, false);
+        }
+    }
+}
+
+void Debugger::sweep_staging_buffers(size_t lane, bool force, bool errors_only) {
+    if (lanes_[lane]->sweeping) return;
+    lanes_[lane]->sweeping = true;
+    std::vector<std::shared_ptr<StagingBuffer>>& buffers = lanes_[lane]->sweep_buffers;
+    {
+        std::lock_guard lock(staging_mutex_);
+        buffers.assign(staging_buffers_.begin(), staging_buffers_.end());
+    }
+    
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& buffer : buffers) {
+        std::unique_lock buffer_lock(buffer->mutex, std::defer_lock);
+        if (force) {
+            // The owner may be waiting for queue space while holding its
+            // lock, so keep draining until it lets go
+            while (!buffer_lock.try_lock()) {
+                drain_lane(*lanes_[lane]);
+                std::this_thread::yield();
+            }
+        } else if (!buffer_lock.try_lock()) {
+            continue; // Owner is appending; it will check the age itself
+        }
+        
+        for (size_t slot = lane * slots_per_lane; slot < (lane + 1) * slots_per_lane; ++slot) {
+            if (slot >= buffer->stages.size()) break;
+            if (errors_only && !error_slot(slot)) continue;
+            const Stage& stage = buffer->stages[slot];
+            const auto max_age = error_slot(slot) ? error_latency_ : staging_max_age_;
+            if (stage.batch && (force || now - stage.opened >= max_age)) {
+                hand_off(*buffer, slot);
+            }
+        }
+    }
+    // Retired buffers are freed once no sweep holds them
+    buffers.clear();
+    lanes_[lane]->sweeping = false;
+}
+
+void Debugger::retire_staging_buffer(const std::shared_ptr<StagingBuffer>& buffer) {
+    {
+        std::lock_guard buffer_lock(buffer->mutex);
+        for (size_t slot = 0; slot < buffer->stages.size(); ++slot) {
+            Stage& stage = buffer->stages[slot];
+            if (!stage.batch) continue;
+            
+            const size_t lane = slot / slots_per_lane;
+            if (running_.load() && lane < num_lanes_) {
+                hand_off(*buffer, slot);
+            } else {
+                lanes_[lane]->staged_batches.fetch_sub(1);
+                if (error_slot(slot)) {
+                    lanes_[lane]->staged_errors.fetch_sub(1);
+                }
+                recycle_batch(std::exchange(stage.batch, nullptr));
+            }
+        }
+    }
+    
+    std::lock_guard lock(staging_mutex_);
+    buffer->messages.accumulate(retired_messages_);
+    buffer->subitem_messages.accumulate(retired_subitem_messages_);
+    buffer->metrics.accumulate(retired_metrics_);
+    retired_enqueue_wait_.merge(buffer->enqueue_wait.snapshot());
+    std::erase(staging_buffers_, buffer);
+}
+
+Debugger::Batch* Debugger::acquire_batch() {
+    // Once per staging_capacity records; the lanes return batches in bulk
+    std::lock_guard lock(staging_mutex_);
+    if (!free_batches_.empty()) {
+        Batch* batch = free_batches_.back();
+        free_batches_.pop_back();
+        return batch;
+    }
+    
+    // Typical records are well under this; larger ones grow the buffer once
+    // and the batch keeps that capacity when it is recycled
+    static constexpr size_t reserved_bytes_per_record = 128;
+    
+    auto& batch = batch_storage_.emplace_back(std::make_unique<Batch>());
+    batch->bytes.reserve(staging_capacity_ * reserved_bytes_per_record);
+    return batch.get();
+}
+
+void Debugger::recycle_batch(Batch* batch) {
+    batch->bytes.clear();
+    batch->count = 0;
+    std::lock_guard lock(staging_mutex_);
+    free_batches_.push_back(batch);
+}
+
+void Debugger::release_batches(Lane& lane) {
+    if (lane.free_batches.empty()) return;
+    std::lock_guard lock(staging_mutex_);
+    free_batches_.insert(free_batches_.end(), lane.free_batches.begin(), lane.free_batches.end());
+    lane.free_batches.clear();
+}
+
 Debugger::~Debugger() {
     shutdown();
+    
+    // Subscribers may outlive us through user-held pointers
+    std::lock_guard lock(mutex_);
+    subscriptions_.for_each([](const Subscription& subscription) {
+        subscription.subscriber->set_change_listener(nullptr);
+    });
 }
 
 } // namespace debugger
@@ -0,0 +1,348 @@
+#include <debugger/file_sink.hpp>
+#include <debugger/debugger.hpp>
+#include <debugger/clock.hpp>
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <string_view>
+#include <utility>
+
+namespace debugger {
+
+namespace {
+
+constexpr std::string_view segment_extension = ".dlog";
+
+} // namespace
+
+SegmentHeader& FileSink::Segment::header() const {
+    return *reinterpret_cast<SegmentHeader*>(file->data());
+}
+
+FileSink::FileSink(FileSinkOptions options)
+    : options_(std::move(options)) {
+    std::error_code error;
+    std::filesystem::create_directories(options_.directory, error);
+
+    // Continue numbering after the segments already in the directory; they
+    // count towards max_segments as well
+    std::vector<std::pair<uint64_t, std::filesystem::path>> existing;
+    const std::string stem_prefix = options_.prefix + "-";
+    for (std::filesystem::directory_iterator it(options_.directory, error), end; it != end; it.increment(error)) {
+        const std::string name = it->path().filename().string();
+        if (!name.starts_with(stem_prefix) || !name.ends_with(segment_extension)) continue;
+
+        const std::string_view digits = std::string_view(name).substr(
+            stem_prefix.size(), name.size() - stem_prefix.size() - segment_extension.size());
+        uint64_t sequence = 0;
+        const auto [rest, parsed] = std::from_chars(digits.data(), digits.data() + digits.size(), sequence);
+        if (parsed == std::errc() && rest == digits.data() + digits.size()) {
+            existing.emplace_back(sequence, it->path());
+        }
+    }
+    std::sort(existing.begin(), existing.end());
+    for (auto& [sequence, path] : existing) {
+        closed_.push_back(std::move(path));
+        next_sequence_ = sequence + 1;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        rotate();
+    }
+    thread_ = std::thread([this] { run(); });
+}
+
+FileSink::~FileSink() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+
+    if (active_) {
+        publish(*active_);
+        close_segment(*active_);
+        closed_.push_back(active_->file->path());
+        active_.reset();
+    }
+    if (spare_) {
+        discard_segment(std::move(spare_));
+    }
+    enforce_retention(options_.max_segments);
+}
+
+void FileSink::write(std::span<const RecordView> records, const BatchInfo& /*info*/) {
+    std::lock_guard lock(mutex_);
+
+    // Age is only checked as records arrive, so an idle sink does not
+    // produce empty segments
+    if (active_ && options_.max_segment_age.count() > 0 && active_->used > sizeof(SegmentHeader)
+        && std::chrono::steady_clock::now() - active_->opened >= options_.max_segment_age) {
+        rotate();
+    }
+
+    uint64_t written = 0;
+    uint64_t bytes = 0;
+    for (const auto& record : records) {
+        if (append(record)) {
+            ++written;
+            bytes += record.size();
+        }
+    }
+    if (active_) {
+        publish(*active_);
+    }
+
+    records_written_.fetch_add(written, std::memory_order_relaxed);
+    bytes_written_.fetch_add(bytes, std::memory_order_relaxed);
+    records_dropped_.fetch_add(records.size() - written, std::memory_order_relaxed);
+}
+
+bool FileSink::append(const RecordView& record) {
+    if (!active_ && !rotate()) return false;
+
+    describe(record);
+    const auto fits = [&] {
+        return active_->used + scratch_.size() + record.size() <= active_->file->size();
+    };
+    // Records too large for an empty segment are dropped without rotating
+    if (!fits() && active_->used > sizeof(SegmentHeader)) {
+        if (!rotate()) return false;
+        describe(record);
+    }
+    if (!fits()) return false;
+
+    std::byte* out = active_->file->data() + active_->used;
+    if (!scratch_.empty()) {
+        std::memcpy(out, scratch_.data(), scratch_.size());
+    }
+    std::memcpy(out + scratch_.size(), record.bytes(), record.size());
+    active_->used += scratch_.size() + record.size();
+
+    active_->categories.insert(new_categories_.begin(), new_categories_.end());
+    active_->subitems.insert(new_subitems_.begin(), new_subitems_.end());
+    if (active_->first_timestamp == 0) {
+        active_->first_timestamp = record.timestamp();
+    }
+    active_->last_timestamp = record.timestamp();
+    return true;
+}
+
+void FileSink::describe(const RecordView& record) {
+    scratch_.clear();
+    new_categories_.clear();
+    new_subitems_.clear();
+
+    const auto& debugger = Debugger::instance();
+    const uint32_t category = record.category_id();
+    if (!active_->categories.contains(category)) {
+        const Category* info = debugger.category(category);
+        RecordEncoder encoder(scratch_, category, Level::info, 0, record.timestamp(),
+                              info ? std::string_view(info->name()) : std::string_view());
+        encoder.add_flags(record_dictionary);
+        encoder.finish();
+        new_categories_.push_back(category);
+    }
+
+    const uint64_t subitem = record.subitem();
+    if (subitem != 0 && !active_->subitems.contains(subitem)) {
+        if (const auto* info = debugger.subitem_info(subitem)) {
+            RecordEncoder encoder(scratch_, category, Level::info, subitem, record.timestamp(), info->name);
+            encoder.add("id", std::string_view(info->id));
+            encoder.add_flags(record_dictionary);
+            encoder.finish();
+        }
+        new_subitems_.push_back(subitem);
+    }
+}
+
+void FileSink::publish(Segment& segment) {
+    SegmentHeader& header = segment.header();
+    header.first_timestamp = segment.first_timestamp;
+    header.last_timestamp = segment.last_timestamp;
+
+    // A reader that sees the new size also sees the records before it
+    std::atomic_ref<uint64_t>(header.used).store(segment.used, std::memory_order_release);
+}
+
+bool FileSink::rotate() {
+    const bool replacing = active_ != nullptr;
+    if (active_) {
+        publish(*active_);
+        retired_.push_back(std::move(active_));
+    }
+
+    if (spare_) {
+        active_ = std::move(spare_);
+    } else {
+        // The background thread fell behind (or this is the first segment);
+        // a spare it finishes later is discarded rather than reordered
+        if (replacing) {
+            rotation_stalls_.fetch_add(1, std::memory_order_relaxed);
+        }
+        active_ = create_segment(next_sequence_++);
+    }
+    wake_.notify_one();
+
+    if (!active_) return false;
+    active_->opened = std::chrono::steady_clock::now();
+    active_->header().created = RecordClock::now();
+    return true;
+}
+
+std::filesystem::path FileSink::segment_path(uint64_t sequence) const {
+    char number[24];
+    std::snprintf(number, sizeof(number), "-%06llu", static_cast<unsigned long long>(sequence));
+    return options_.directory / (options_.prefix + number + std::string(segment_extension));
+}
+
+std::unique_ptr<FileSink::Segment> FileSink::create_segment(uint64_t sequence) {
+    const size_t size = std::max(options_.segment_size, sizeof(SegmentHeader));
+    auto file = MappedFile::create(segment_path(sequence), size);
+    if (!file) return nullptr;
+
+    auto segment = std::make_unique<Segment>();
+    segment->file = std::move(file);
+    segment->sequence = sequence;
+    segment->used = sizeof(SegmentHeader);
+    segment->flushed = 0;
+
+    SegmentHeader& header = segment->header();
+    std::memcpy(header.magic, segment_magic, sizeof(segment_magic));
+    header.format_version = record_format_version;
+    header.header_size = sizeof(SegmentHeader);
+    header.sequence = sequence;
+    header.used = sizeof(SegmentHeader);
+
+    segments_created_.fetch_add(1, std::memory_order_relaxed);
+    return segment;
+}
+
+void FileSink::close_segment(Segment& segment) {
+    // Data first, then the header that marks it complete
+    segment.file->flush(0, segment.used);
+    segment.header().flags |= segment_closed;
+    segment.file->flush(0, sizeof(SegmentHeader));
+    segment.file->close(segment.used);
+}
+
+void FileSink::discard_segment(std::unique_ptr<Segment> segment) {
+    const std::filesystem::path path = segment->file->path();
+    segment->file->close(0);
+    segment.reset();
+    std::error_code error;
+    std::filesystem::remove(path, error);
+}
+
+void FileSink::enforce_retention(size_t keep) {
+    if (options_.max_segments == 0) return;
+    while (closed_.size() > keep) {
+        std::error_code error;
+        if (std::filesystem::remove(closed_.front(), error)) {
+            segments_deleted_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Along with the index LogReader may have saved for it
+        std::filesystem::path index = closed_.front();
+        index += ".idx";
+        std::filesystem::remove(index, error);
+        closed_.pop_front();
+    }
+}
+
+void FileSink::run() {
+    auto next_flush = std::chrono::steady_clock::now() + options_.flush_interval;
+    bool spare_failed = false;
+
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        if (!retired_.empty()) {
+            auto retired = std::move(retired_);
+            retired_.clear();
+            lock.unlock();
+            for (auto& segment : retired) {
+                close_segment(*segment);
+                closed_.push_back(segment->file->path());
+            }
+            // The active segment counts towards max_segments
+            enforce_retention(options_.max_segments > 0 ? options_.max_segments - 1 : 0);
+            lock.lock();
+            continue;
+        }
+
+        if (!spare_ && !stopping_ && !spare_failed) {
+            const uint64_t sequence = next_sequence_++;
+            lock.unlock();
+            auto segment = create_segment(sequence);
+            lock.lock();
+
+            spare_failed = segment == nullptr;
+            if (segment && active_ && active_->sequence > sequence) {
+                // A rotation created a newer segment while this one was made
+                lock.unlock();
+                discard_segment(std::move(segment));
+                lock.lock();
+            } else {
+                spare_ = std::move(segment);
+            }
+            continue;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= next_flush) {
+            next_flush = now + options_.flush_interval;
+            spare_failed = false;
+
+            // Start write-back of what was appended since the last pass. The
+            // segment stays valid after unlocking: only this thread closes
+            // retired segments.
+            if (active_ && active_->used > active_->flushed) {
+                Segment* segment = active_.get();
+                const size_t used = segment->used;
+                lock.unlock();
+                segment->file->flush_async(0, sizeof(SegmentHeader));
+                segment->file->flush_async(segment->flushed, used - segment->flushed);
+                segment->flushed = used;
+                lock.lock();
+                continue;
+            }
+        }
+
+        if (stopping_) break;
+        wake_.wait_until(lock, next_flush);
+    }
+}
+
+void FileSink::flush() {
+    std::lock_guard lock(mutex_);
+    if (active_) {
+        publish(*active_);
+        active_->file->flush(0, active_->used);
+    }
+}
+
+bool FileSink::is_open() const {
+    std::lock_guard lock(mutex_);
+    return active_ != nullptr;
+}
+
+std::filesystem::path FileSink::current_segment() const {
+    std::lock_guard lock(mutex_);
+    return active_ ? active_->file->path() : std::filesystem::path();
+}
+
+FileSinkStats FileSink::stats() const {
+    FileSinkStats stats;
+    stats.records_written = records_written_.load(std::memory_order_relaxed);
+    stats.records_dropped = records_dropped_.load(std::memory_order_relaxed);
+    stats.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    stats.segments_created = segments_created_.load(std::memory_order_relaxed);
+    stats.segments_deleted = segments_deleted_.load(std::memory_order_relaxed);
+    stats.rotation_stalls = rotation_stalls_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace debugger
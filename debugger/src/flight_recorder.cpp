@@ -0,0 +1,185 @@
+#include <debugger/flight_recorder.hpp>
+#include <debugger/clock.hpp>
+#include "mapped_file.hpp"
+#include <bit>
+
+namespace debugger {
+
+namespace {
+
+// Copy length bytes starting at a ring offset, continuing at the start of
+// the ring past its end
+void copy_from_ring(std::byte* out, const std::byte* ring, size_t ring_size, size_t offset, size_t length) {
+    const size_t first = std::min(length, ring_size - offset);
+    std::memcpy(out, ring + offset, first);
+    std::memcpy(out + first, ring, length - first);
+}
+
+} // namespace
+
+std::unique_ptr<FlightRecorder> FlightRecorder::create(const FlightRecorderOptions& options) {
+    const size_t stripe_count = std::max<size_t>(options.stripes, 1);
+    const size_t dictionary_offset = sizeof(FlightRecorderHeader) + stripe_count * sizeof(FlightStripe);
+    const size_t data_offset = dictionary_offset + options.dictionary_size;
+    if (options.size <= data_offset) return nullptr;
+
+    const size_t stripe_size = std::bit_floor((options.size - data_offset) / stripe_count);
+    if (stripe_size < 4096) return nullptr;
+
+    // Keep the previous recording; it is most likely the one from a crash
+    std::error_code error;
+    if (std::filesystem::exists(options.path, error)) {
+        std::filesystem::path previous = options.path;
+        previous += ".1";
+        std::filesystem::rename(options.path, previous, error);
+    }
+
+    auto file = MappedFile::create(options.path, data_offset + stripe_count * stripe_size);
+    if (!file) return nullptr;
+
+    std::unique_ptr<FlightRecorder> recorder(new FlightRecorder());
+    recorder->header_ = reinterpret_cast<FlightRecorderHeader*>(file->data());
+    recorder->stripes_ = reinterpret_cast<FlightStripe*>(file->data() + sizeof(FlightRecorderHeader));
+    recorder->rings_ = file->data() + data_offset;
+    recorder->stripe_count_ = stripe_count;
+    recorder->stripe_size_ = stripe_size;
+    recorder->file_ = std::move(file);
+
+    // A new file reads as zeros, so every head and commit word starts out 0
+    FlightRecorderHeader& header = *recorder->header_;
+    std::memcpy(header.magic, flight_recorder_magic, sizeof(flight_recorder_magic));
+    header.format_version = record_format_version;
+    header.stripe_count = static_cast<uint32_t>(stripe_count);
+    header.stripe_size = stripe_size;
+    header.dictionary_offset = dictionary_offset;
+    header.dictionary_size = options.dictionary_size;
+    header.data_offset = data_offset;
+    header.created = RecordClock::now();
+    return recorder;
+}
+
+FlightRecorder::~FlightRecorder() = default;
+
+const std::filesystem::path& FlightRecorder::path() const {
+    return file_->path();
+}
+
+void FlightRecorder::describe_category(uint32_t id, std::string_view name) {
+    std::lock_guard lock(dictionary_mutex_);
+    scratch_.clear();
+    RecordEncoder encoder(scratch_, id, Level::info, 0, RecordClock::now(), name);
+    encoder.add_flags(record_dictionary);
+    encoder.finish();
+    append_dictionary();
+}
+
+void FlightRecorder::describe_subitem(uint64_t index, uint32_t category, std::string_view id, std::string_view name) {
+    std::lock_guard lock(dictionary_mutex_);
+    scratch_.clear();
+    RecordEncoder encoder(scratch_, category, Level::info, index, RecordClock::now(), name);
+    encoder.add("id", id);
+    encoder.add_flags(record_dictionary);
+    encoder.finish();
+    append_dictionary();
+}
+
+void FlightRecorder::append_dictionary() {
+    const uint64_t used = header_->dictionary_used;
+    if (used + scratch_.size() > header_->dictionary_size) {
+        dictionary_overflow_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    std::memcpy(file_->data() + header_->dictionary_offset + used, scratch_.data(), scratch_.size());
+    std::atomic_ref<uint64_t>(header_->dictionary_used).store(used + scratch_.size(), std::memory_order_release);
+}
+
+std::unique_ptr<FlightRecording> FlightRecording::load(const std::filesystem::path& path) {
+    auto file = MappedFile::open(path, false);
+    if (!file || file->size() < sizeof(FlightRecorderHeader)) return nullptr;
+
+    FlightRecorderHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, flight_recorder_magic, sizeof(flight_recorder_magic)) != 0
+        || header.format_version != record_format_version
+        || !std::has_single_bit(header.stripe_size)
+        || header.dictionary_offset + header.dictionary_size > header.data_offset
+        || header.dictionary_used > header.dictionary_size
+        || header.data_offset + header.stripe_count * header.stripe_size > file->size()) {
+        return nullptr;
+    }
+
+    auto recording = std::make_unique<FlightRecording>();
+    std::vector<size_t> offsets;
+
+    // Dictionary records are complete up to dictionary_used
+    const std::byte* dictionary = file->data() + header.dictionary_offset;
+    for (size_t offset = 0; offset + sizeof(RecordHeader) <= header.dictionary_used;) {
+        const RecordView record(dictionary + offset);
+        if (record.size() < sizeof(RecordHeader) || offset + record.size() > header.dictionary_used) break;
+        if (record.subitem() == 0) {
+            recording->categories_[record.category_id()] = std::string(record.message());
+        } else {
+            Subitem subitem{record.category_id(), {}, std::string(record.message())};
+            record.for_each_field([&](const FieldView& field) {
+                if (field.key() == "id") subitem.id = std::string(field.as_string());
+            });
+            recording->subitems_[record.subitem()] = std::move(subitem);
+        }
+        offset += record.size();
+    }
+
+    // Walk the last lap of each ring. Where a commit word does not match,
+    // step forward a word at a time until frames line up again.
+    for (uint32_t stripe = 0; stripe < header.stripe_count; ++stripe) {
+        FlightStripe head;
+        std::memcpy(&head, file->data() + sizeof(FlightRecorderHeader) + stripe * sizeof(FlightStripe), sizeof(head));
+        const std::byte* ring = file->data() + header.data_offset + stripe * header.stripe_size;
+        const uint64_t mask = header.stripe_size - 1;
+        const uint64_t end = head.head;
+
+        uint64_t position = end > header.stripe_size ? end - header.stripe_size : 0;
+        position = (position + 7) & ~uint64_t{7};
+        while (position + sizeof(uint64_t) + sizeof(RecordHeader) <= end) {
+            uint64_t commit;
+            std::memcpy(&commit, ring + (position & mask), sizeof(commit));
+            RecordHeader record;
+            copy_from_ring(reinterpret_cast<std::byte*>(&record), ring, header.stripe_size,
+                           (position + sizeof(uint64_t)) & mask, sizeof(record));
+            if (commit != (position | 1) || record.size < sizeof(RecordHeader)
+                || record.size % record_alignment != 0
+                || position + sizeof(uint64_t) + record.size > end) {
+                position += sizeof(uint64_t);
+                continue;
+            }
+
+            const size_t offset = recording->bytes_.size();
+            recording->bytes_.resize(offset + record.size);
+            copy_from_ring(recording->bytes_.data() + offset, ring, header.stripe_size,
+                           (position + sizeof(uint64_t)) & mask, record.size);
+            offsets.push_back(offset);
+            position += sizeof(uint64_t) + record.size;
+        }
+    }
+
+    recording->records_.reserve(offsets.size());
+    for (size_t offset : offsets) {
+        recording->records_.emplace_back(recording->bytes_.data() + offset);
+    }
+    // Sequence numbers order records from different threads exactly, where
+    // timestamps can tie or, across cores, disagree by a little
+    std::sort(recording->records_.begin(), recording->records_.end(),
+              [](const RecordView& a, const RecordView& b) { return a.sequence() < b.sequence(); });
+    return recording;
+}
+
+std::string_view FlightRecording::category_name(uint32_t id) const {
+    auto it = categories_.find(id);
+    return it == categories_.end() ? std::string_view() : std::string_view(it->second);
+}
+
+const FlightRecording::Subitem* FlightRecording::subitem(uint64_t index) const {
+    auto it = subitems_.find(index);
+    return it == subitems_.end() ? nullptr : &it->second;
+}
+
+} // namespace debugger
@@ -0,0 +1,418 @@
+#include <debugger/graph_state.hpp>
+#include <debugger/socket_sink.hpp>
+#include <algorithm>
+#include <utility>
+
+namespace debugger {
+
+using json = nlohmann::json;
+
+namespace {
+
+bool contains(const std::vector<std::string>& types, std::string_view type) {
+    return std::find(types.begin(), types.end(), type) != types.end();
+}
+
+} // namespace
+
+// GraphBatches implementation
+GraphBatches::GraphBatches(std::string framework, size_t max_bytes)
+    : max_bytes_(max_bytes) {
+    prefix_ = json{{"framework", std::move(framework)}}.dump();
+    prefix_.pop_back();
+    prefix_ += ",\"command\":";
+}
+
+void GraphBatches::append(std::string_view command, const json& payload) {
+    if (batches_.empty() || batches_.back().bytes.size() >= max_bytes_) {
+        batches_.emplace_back();
+    }
+    GraphBatch& batch = batches_.back();
+    batch.bytes += prefix_;
+    batch.bytes += json(command).dump();
+    batch.bytes += ",\"payload\":";
+    batch.bytes += payload.dump(-1, ' ', false, json::error_handler_t::replace);
+    batch.bytes += "}\n";
+    ++batch.commands;
+}
+
+// GraphState implementation
+GraphState::Vertex& GraphState::vertex(std::string_view name, bool& created) {
+    if (auto it = vertices_.find(name); it != vertices_.end()) return it->second;
+
+    Vertex& vertex = vertices_.emplace(std::string(name), Vertex{}).first->second;
+    vertex.name = name;
+    order_.push_back(&vertex);
+    mark(vertex);
+    created = true;
+    return vertex;
+}
+
+void GraphState::mark(Vertex& vertex) {
+    if (!std::exchange(vertex.dirty, true)) {
+        dirty_.push_back(&vertex);
+    }
+}
+
+bool GraphState::add_edge(std::map<std::string, EdgeSet, std::less<>>& edges, std::string_view other,
+                          std::string_view type) {
+    auto it = edges.find(other);
+    if (it == edges.end()) {
+        it = edges.emplace(std::string(other), EdgeSet{}).first;
+    }
+    EdgeSet& set = it->second;
+    if (contains(set.types, type)) return false;
+    set.types.emplace_back(type);
+    set.dirty = true;
+    return true;
+}
+
+bool GraphState::remove_edges(std::map<std::string, EdgeSet, std::less<>>& edges, std::string_view other) {
+    auto it = edges.find(other);
+    if (it == edges.end() || it->second.types.empty()) return false;
+    it->second.types.clear();
+    it->second.dirty = true;
+    return true;
+}
+
+void GraphState::create(std::string_view name) {
+    ++updates_;
+    bool created = false;
+    vertex(name, created);
+    if (!created) ++redundant_;
+}
+
+void GraphState::set_type(std::string_view name, std::string_view type) {
+    ++updates_;
+    if (type.empty()) type = "unknown";
+    bool created = false;
+    Vertex& target = vertex(name, created);
+    if (target.type == type) {
+        if (!created) ++redundant_;
+        return;
+    }
+    target.type = type;
+    mark(target);
+}
+
+void GraphState::set_parent(std::string_view name, std::string_view parent) {
+    ++updates_;
+    if (parent == "none") parent = {};
+    if (parent.empty() && !vertices_.contains(name)) {
+        // The UI does not create a vertex to clear its parent either
+        ++redundant_;
+        return;
+    }
+    bool created = false;
+    Vertex& target = vertex(name, created);
+    if (!parent.empty()) {
+        vertex(parent, created);
+    }
+    if (target.parent == parent) {
+        if (!created) ++redundant_;
+        return;
+    }
+    target.parent = parent;
+    mark(target);
+}
+
+void GraphState::add_extension(std::string_view name, std::string_view extension, std::string_view type) {
+    ++updates_;
+    bool created = false;
+    Vertex& target = vertex(name, created);
+    vertex(extension, created);
+    if (add_edge(target.extensions, extension, type)) {
+        mark(target);
+    } else if (!created) {
+        ++redundant_;
+    }
+}
+
+void GraphState::remove_extension(std::string_view name, std::string_view extension) {
+    ++updates_;
+    auto it = vertices_.find(name);
+    if (it != vertices_.end() && remove_edges(it->second.extensions, extension)) {
+        mark(it->second);
+    } else {
+        ++redundant_;
+    }
+}
+
+void GraphState::add_interface(std::string_view name, std::string_view iface, std::string_view type) {
+    ++updates_;
+    bool created = false;
+    Vertex& target = vertex(name, created);
+    vertex(iface, created);
+    if (add_edge(target.interfaces, iface, type)) {
+        mark(target);
+    } else if (!created) {
+        ++redundant_;
+    }
+}
+
+void GraphState::remove_interface(std::string_view name, std::string_view iface) {
+    ++updates_;
+    auto it = vertices_.find(name);
+    if (it != vertices_.end() && remove_edges(it->second.interfaces, iface)) {
+        mark(it->second);
+    } else {
+        ++redundant_;
+    }
+}
+
+size_t GraphState::edges() const {
+    size_t count = 0;
+    for (const Vertex* vertex : order_) {
+        count += vertex->parent.empty() ? 0 : 1;
+        for (const auto& [other, set] : vertex->extensions) count += set.types.size();
+        for (const auto& [other, set] : vertex->interfaces) count += set.types.size();
+    }
+    return count;
+}
+
+void GraphState::take_changes(GraphBatches& out) {
+    // Vertices first, so no command relies on the UI creating one for it
+    for (Vertex* vertex : dirty_) {
+        if (!std::exchange(vertex->sent, true)) {
+            out.append("meta-class:create", {{"name", vertex->name}});
+        }
+    }
+    for (Vertex* vertex : dirty_) {
+        append_vertex(out, *vertex, false);
+    }
+    dirty_.clear();
+}
+
+void GraphState::snapshot(GraphBatches& out) {
+    for (Vertex* vertex : order_) {
+        vertex->sent = true;
+        out.append("meta-class:create", {{"name", vertex->name}});
+    }
+    for (Vertex* vertex : order_) {
+        append_vertex(out, *vertex, true);
+    }
+    dirty_.clear();
+}
+
+void GraphState::append_vertex(GraphBatches& out, Vertex& vertex, bool everything) {
+    // Everything the UI needs beyond a bare vertex, or only what changed
+    // since it was last sent
+    vertex.dirty = false;
+    if (everything ? vertex.type != "unknown" : vertex.type != vertex.sent_type) {
+        out.append("meta-class:set-type", {{"name", vertex.name}, {"type", vertex.type}});
+    }
+    vertex.sent_type = vertex.type;
+
+    if (everything ? !vertex.parent.empty() || !vertex.sent_parent.empty() : vertex.parent != vertex.sent_parent) {
+        out.append("meta-class:set-parent", {{"name", vertex.name},
+                                             {"parent", vertex.parent.empty() ? "none" : vertex.parent}});
+    }
+    vertex.sent_parent = vertex.parent;
+
+    // A remove drops every type between the pair, so any type that went
+    // away means removing them all and adding back the rest
+    const auto append_edges = [&](std::map<std::string, EdgeSet, std::less<>>& edges, const char* key,
+                                  std::string_view add, std::string_view remove) {
+        for (auto it = edges.begin(); it != edges.end();) {
+            EdgeSet& set = it->second;
+            if (everything || set.dirty) {
+                const bool removed = std::any_of(set.sent.begin(), set.sent.end(), [&](const std::string& type) {
+                    return !contains(set.types, type);
+                });
+                if (removed) {
+                    out.append(remove, {{"name", vertex.name}, {key, it->first}});
+                }
+                for (const std::string& type : set.types) {
+                    if (!everything && !removed && contains(set.sent, type)) continue;
+                    json payload = {{"name", vertex.name}, {key, it->first}};
+                    if (!type.empty()) {
+                        payload["type"] = type;
+                    }
+                    out.append(add, payload);
+                }
+                set.sent = set.types;
+                set.dirty = false;
+            }
+            it = set.types.empty() ? edges.erase(it) : std::next(it);
+        }
+    };
+    append_edges(vertex.extensions, "extension", "meta-class:add-extension", "meta-class:remove-extension");
+    append_edges(vertex.interfaces, "interface", "meta-class:add-interface", "meta-class:remove-interface");
+}
+
+// GraphEmitter implementation
+GraphEmitter::GraphEmitter(GraphBatchWriter writer, GraphEmitterOptions options)
+    : options_(std::move(options))
+    , writer_(std::move(writer)) {
+    thread_ = std::thread([this] { run(); });
+}
+
+GraphEmitter::GraphEmitter(std::shared_ptr<SocketSink> sink, GraphEmitterOptions options)
+    : options_(std::move(options))
+    , writer_([target = sink.get()](GraphBatch& batch) { return target->send_frames(batch.bytes, batch.commands); })
+    , sink_(std::move(sink))
+    , seen_connects_(sink_->stats().connects) {
+    thread_ = std::thread([this] { run(); });
+}
+
+GraphEmitter::~GraphEmitter() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+template<typename Update>
+void GraphEmitter::update(Update&& apply) {
+    bool opened = false;
+    {
+        std::lock_guard lock(mutex_);
+        const bool had_changes = state_.has_changes();
+        apply(state_);
+        if (!had_changes && state_.has_changes()) {
+            window_start_ = std::chrono::steady_clock::now();
+            opened = true;
+        }
+    }
+    if (opened) {
+        wake_.notify_one();
+    }
+}
+
+void GraphEmitter::create(std::string_view name) {
+    update([&](GraphState& state) { state.create(name); });
+}
+
+void GraphEmitter::set_type(std::string_view name, std::string_view type) {
+    update([&](GraphState& state) { state.set_type(name, type); });
+}
+
+void GraphEmitter::set_parent(std::string_view name, std::string_view parent) {
+    update([&](GraphState& state) { state.set_parent(name, parent); });
+}
+
+void GraphEmitter::add_extension(std::string_view name, std::string_view extension, std::string_view type) {
+    update([&](GraphState& state) { state.add_extension(name, extension, type); });
+}
+
+void GraphEmitter::remove_extension(std::string_view name, std::string_view extension) {
+    update([&](GraphState& state) { state.remove_extension(name, extension); });
+}
+
+void GraphEmitter::add_interface(std::string_view name, std::string_view iface, std::string_view type) {
+    update([&](GraphState& state) { state.add_interface(name, iface, type); });
+}
+
+void GraphEmitter::remove_interface(std::string_view name, std::string_view iface) {
+    update([&](GraphState& state) { state.remove_interface(name, iface); });
+}
+
+void GraphEmitter::resync() {
+    {
+        std::lock_guard lock(mutex_);
+        resync_ = true;
+    }
+    wake_.notify_one();
+}
+
+void GraphEmitter::flush() {
+    std::unique_lock lock(mutex_);
+    window_start_ = {};
+    blocked_ = false;
+    wake_.notify_one();
+    idle_.wait(lock, [&] {
+        return exited_ || blocked_
+            || (!state_.has_changes() && !resync_ && outbox_next_ == outbox_.size());
+    });
+}
+
+GraphEmitterStats GraphEmitter::stats() const {
+    std::lock_guard lock(mutex_);
+    GraphEmitterStats stats;
+    stats.updates = state_.updates();
+    stats.redundant = state_.redundant();
+    stats.commands_sent = commands_sent_;
+    stats.batches_sent = batches_sent_;
+    stats.resyncs = resyncs_;
+    stats.vertices = state_.vertices();
+    stats.edges = state_.edges();
+    return stats;
+}
+
+void GraphEmitter::run() {
+    const auto ready = [&] {
+        return stopping_ || resync_ || state_.has_changes() || outbox_next_ < outbox_.size();
+    };
+    const auto stopping = [&] { return stopping_; };
+
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        if (sink_) {
+            // Look for reconnections even while idle: the UI on the other
+            // end may be new and waiting for the graph
+            while (!ready()) {
+                wake_.wait_for(lock, options_.window, ready);
+                if (sink_->stats().connects != seen_connects_) break;
+            }
+            const uint64_t connects = sink_->stats().connects;
+            if (connects != seen_connects_) {
+                seen_connects_ = connects;
+                resync_ = true;
+            }
+            if (!sink_->connected()) {
+                // Held until the connection is back, which resyncs anyway
+                blocked_ = true;
+                idle_.notify_all();
+                if (stopping_) break;
+                wake_.wait_for(lock, options_.window, stopping);
+                continue;
+            }
+        } else {
+            wake_.wait(lock, ready);
+        }
+
+        // Let the window fill
+        wake_.wait_until(lock, window_start_ + options_.window, stopping);
+
+        if (outbox_next_ == outbox_.size()) {
+            GraphBatches batches(options_.framework, options_.max_batch_bytes);
+            if (std::exchange(resync_, false)) {
+                state_.snapshot(batches);
+                ++resyncs_;
+            } else {
+                state_.take_changes(batches);
+            }
+            outbox_ = std::move(batches.batches());
+            outbox_next_ = 0;
+        }
+        blocked_ = !send_outbox(lock);
+        idle_.notify_all();
+
+        if (stopping_) break;
+        if (blocked_) {
+            wake_.wait_for(lock, options_.window, stopping);
+        }
+    }
+    exited_ = true;
+    idle_.notify_all();
+}
+
+bool GraphEmitter::send_outbox(std::unique_lock<std::mutex>& lock) {
+    // Only this thread touches the outbox, so the writer runs unlocked
+    while (outbox_next_ < outbox_.size()) {
+        GraphBatch& batch = outbox_[outbox_next_];
+        const size_t commands = batch.commands;
+        lock.unlock();
+        const bool taken = writer_(batch);
+        lock.lock();
+        if (!taken) return false;
+        ++outbox_next_;
+        commands_sent_ += commands;
+        ++batches_sent_;
+    }
+    return true;
+}
+
+} // namespace debugger
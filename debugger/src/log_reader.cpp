@@ -0,0 +1,416 @@
+#include <debugger/log_reader.hpp>
+#include <debugger/flight_recorder.hpp>
+#include <debugger/log_file.hpp>
+#include <debugger/topic_trie.hpp>
+#include "mapped_file.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+namespace debugger {
+
+namespace {
+
+using json = nlohmann::json;
+
+// Bump when the cached index layout changes; older caches are rebuilt
+constexpr uint64_t index_version = 1;
+
+// Summary of the records in one block of a segment
+struct Block {
+    uint64_t begin{0};          // Byte offsets of the block in the segment
+    uint64_t end{0};
+    uint64_t first_timestamp{std::numeric_limits<uint64_t>::max()};
+    uint64_t last_timestamp{0}; // Smallest and largest, not first and last written
+    uint64_t categories{0};     // Bloom masks of the ids present
+    uint64_t subitems{0};
+    uint64_t levels{0};         // One bit per Level
+};
+
+uint64_t bloom_bit(uint64_t id) {
+    return uint64_t{1} << (id % 64);
+}
+
+uint64_t level_bit(Level level) {
+    return uint64_t{1} << static_cast<unsigned>(level);
+}
+
+struct Subitem {
+    uint32_t category{0};
+    std::string id;
+    std::string name;
+};
+
+struct Dictionary {
+    std::unordered_map<uint32_t, std::string> categories;
+    std::unordered_map<uint64_t, Subitem> subitems;
+
+    void add(const RecordView& record) {
+        if (record.subitem() == 0) {
+            categories[record.category_id()] = std::string(record.message());
+            return;
+        }
+        Subitem subitem{record.category_id(), {}, std::string(record.message())};
+        record.for_each_field([&](const FieldView& field) {
+            if (field.key() == "id") subitem.id = std::string(field.as_string());
+        });
+        subitems[record.subitem()] = std::move(subitem);
+    }
+};
+
+std::filesystem::path index_path(const std::filesystem::path& segment) {
+    std::filesystem::path path = segment;
+    path += ".idx";
+    return path;
+}
+
+} // namespace
+
+struct LogReader::Source {
+    std::filesystem::path path;
+
+    // A FileSink segment, queried through its index
+    std::unique_ptr<MappedFile> file;
+    SegmentHeader header{};
+    uint64_t used{0};
+    Dictionary dictionary;
+    std::vector<Block> blocks;
+    uint64_t first_timestamp{std::numeric_limits<uint64_t>::max()};
+    uint64_t last_timestamp{0};
+
+    // Or a flight recording, filtered in full
+    std::unique_ptr<FlightRecording> recording;
+
+    void build_index(size_t block_size);
+    bool load_index(size_t block_size);
+    void save_index(size_t block_size) const;
+    void summarize();
+};
+
+void LogReader::Source::build_index(size_t block_size) {
+    const std::byte* data = file->data();
+    Block block;
+    bool open = false;
+
+    uint64_t offset = header.header_size;
+    while (offset + sizeof(RecordHeader) <= used) {
+        const RecordView record(data + offset);
+        const size_t size = record.size();
+        // A torn tail from a writer that died mid-batch ends the segment
+        if (size < sizeof(RecordHeader) || size % record_alignment != 0 || offset + size > used) break;
+
+        if (record.dictionary()) {
+            dictionary.add(record);
+        } else {
+            if (!open) {
+                block = Block{};
+                block.begin = offset;
+                open = true;
+            }
+            block.first_timestamp = std::min(block.first_timestamp, record.timestamp());
+            block.last_timestamp = std::max(block.last_timestamp, record.timestamp());
+            block.categories |= bloom_bit(record.category_id());
+            if (record.subitem() != 0) {
+                block.subitems |= bloom_bit(record.subitem());
+            }
+            block.levels |= level_bit(record.level());
+        }
+        offset += size;
+
+        if (open && offset - block.begin >= block_size) {
+            block.end = offset;
+            blocks.push_back(block);
+            open = false;
+        }
+    }
+    if (open) {
+        block.end = offset;
+        blocks.push_back(block);
+    }
+}
+
+bool LogReader::Source::load_index(size_t block_size) {
+    std::ifstream in(index_path(path), std::ios::binary);
+    if (!in) return false;
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    const json index = json::from_msgpack(bytes, true, false);
+    if (index.is_discarded() || !index.is_object()
+        || index.value("version", uint64_t{0}) != index_version
+        || index.value("sequence", uint64_t{0}) != header.sequence
+        || index.value("used", uint64_t{0}) != used
+        || index.value("block_size", uint64_t{0}) != block_size) {
+        return false;
+    }
+
+    // Entries are checked before use; a damaged index is rebuilt
+    const auto entries = [&](const char* key, size_t arity) {
+        const auto it = index.find(key);
+        if (it == index.end() || !it->is_array()) return false;
+        return std::all_of(it->begin(), it->end(), [&](const json& entry) {
+            return entry.is_array() && entry.size() == arity;
+        });
+    };
+    if (!entries("categories", 2) || !entries("subitems", 4) || !entries("blocks", 7)) return false;
+
+    for (const auto& entry : index.at("categories")) {
+        if (!entry[0].is_number_unsigned() || !entry[1].is_string()) return false;
+        dictionary.categories[entry.at(0).get<uint32_t>()] = entry.at(1).get<std::string>();
+    }
+    for (const auto& entry : index.at("subitems")) {
+        if (!entry[0].is_number_unsigned() || !entry[1].is_number_unsigned()
+            || !entry[2].is_string() || !entry[3].is_string()) return false;
+        dictionary.subitems[entry.at(0).get<uint64_t>()] =
+            Subitem{entry.at(1).get<uint32_t>(), entry.at(2).get<std::string>(), entry.at(3).get<std::string>()};
+    }
+    for (const auto& entry : index.at("blocks")) {
+        if (!std::all_of(entry.begin(), entry.end(), [](const json& v) { return v.is_number_unsigned(); })) return false;
+        Block block;
+        block.begin = entry.at(0).get<uint64_t>();
+        block.end = entry.at(1).get<uint64_t>();
+        block.first_timestamp = entry.at(2).get<uint64_t>();
+        block.last_timestamp = entry.at(3).get<uint64_t>();
+        block.categories = entry.at(4).get<uint64_t>();
+        block.subitems = entry.at(5).get<uint64_t>();
+        block.levels = entry.at(6).get<uint64_t>();
+        if (block.begin < header.header_size || block.begin > block.end || block.end > used) return false;
+        blocks.push_back(block);
+    }
+    return true;
+}
+
+void LogReader::Source::save_index(size_t block_size) const {
+    json categories = json::array();
+    for (const auto& [id, name] : dictionary.categories) {
+        categories.push_back({id, name});
+    }
+    json subitems = json::array();
+    for (const auto& [index, subitem] : dictionary.subitems) {
+        subitems.push_back({index, subitem.category, subitem.id, subitem.name});
+    }
+    json summaries = json::array();
+    for (const Block& block : blocks) {
+        summaries.push_back({block.begin, block.end, block.first_timestamp, block.last_timestamp,
+                             block.categories, block.subitems, block.levels});
+    }
+    const json index = {
+        {"version", index_version},
+        {"sequence", header.sequence},
+        {"used", used},
+        {"block_size", block_size},
+        {"categories", std::move(categories)},
+        {"subitems", std::move(subitems)},
+        {"blocks", std::move(summaries)}
+    };
+
+    // Written aside and renamed, so a reader never sees half an index
+    const std::filesystem::path target = index_path(path);
+    std::filesystem::path temporary = target;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return;
+        const std::vector<uint8_t> bytes = json::to_msgpack(index);
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!out) return;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, target, error);
+}
+
+void LogReader::Source::summarize() {
+    for (const Block& block : blocks) {
+        first_timestamp = std::min(first_timestamp, block.first_timestamp);
+        last_timestamp = std::max(last_timestamp, block.last_timestamp);
+    }
+}
+
+LogReader::LogReader(const std::vector<std::filesystem::path>& paths, LogReaderOptions options)
+    : options_(options) {
+    for (const auto& path : paths) {
+        std::error_code error;
+        if (!std::filesystem::is_directory(path, error)) {
+            add_file(path);
+            continue;
+        }
+
+        // Segment names sort in sequence order
+        std::vector<std::filesystem::path> files;
+        for (std::filesystem::directory_iterator it(path, error), end; it != end; it.increment(error)) {
+            if (it->is_regular_file(error) && it->path().extension() != ".idx" && it->path().extension() != ".tmp") {
+                files.push_back(it->path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            add_file(file);
+        }
+    }
+}
+
+LogReader::~LogReader() = default;
+
+void LogReader::add_file(const std::filesystem::path& path) {
+    auto file = MappedFile::open(path, false);
+    if (!file) return;
+
+    auto source = std::make_unique<Source>();
+    source->path = path;
+
+    char magic[8] = {};
+    std::memcpy(magic, file->data(), std::min(file->size(), sizeof(magic)));
+    if (std::memcmp(magic, flight_recorder_magic, sizeof(magic)) == 0) {
+        file.reset();
+        source->recording = FlightRecording::load(path);
+        if (source->recording) {
+            sources_.push_back(std::move(source));
+        }
+        return;
+    }
+
+    if (file->size() < sizeof(SegmentHeader)) return;
+    std::memcpy(&source->header, file->data(), sizeof(SegmentHeader));
+    if (!valid_segment_header(source->header)) return;
+
+    // A segment still being written is read up to its last published batch
+    source->used = std::min<uint64_t>(source->header.used, file->size());
+    source->file = std::move(file);
+
+    // Only closed segments are final, so only their index is worth keeping
+    const bool closed = (source->header.flags & segment_closed) != 0;
+    if (!closed || !options_.cache_index || !source->load_index(options_.block_size)) {
+        source->dictionary = {};
+        source->blocks.clear();
+        source->build_index(options_.block_size);
+        if (closed && options_.cache_index) {
+            source->save_index(options_.block_size);
+        }
+    }
+    source->summarize();
+    sources_.push_back(std::move(source));
+}
+
+std::vector<std::filesystem::path> LogReader::files() const {
+    std::vector<std::filesystem::path> result;
+    for (const auto& source : sources_) {
+        result.push_back(source->path);
+    }
+    return result;
+}
+
+LogQueryStats LogReader::query(const LogQuery& query, const std::function<bool(const LogEntry&)>& fn) {
+    LogQueryStats stats;
+    const bool pattern = query.category.find('*') != std::string::npos;
+    const auto category_matches = [&](std::string_view name) {
+        return query.category.empty()
+            || (pattern ? TopicTrie<bool>::matches(query.category, name) : name == query.category);
+    };
+    const uint64_t levels = 0xf & (uint64_t{0xf} << static_cast<unsigned>(query.min_level));
+    const auto accept = [&](const RecordView& record) {
+        return !record.dictionary()
+            && record.timestamp() >= query.from && record.timestamp() < query.to
+            && (level_bit(record.level()) & levels) != 0;
+    };
+
+    for (const auto& source : sources_) {
+        if (source->recording) {
+            const FlightRecording& recording = *source->recording;
+            for (const RecordView& record : recording.records()) {
+                ++stats.records_scanned;
+                if (!accept(record)) continue;
+                const std::string_view category = recording.category_name(record.category_id());
+                if (!category_matches(category)) continue;
+                const FlightRecording::Subitem* subitem = recording.subitem(record.subitem());
+                if (!query.subitem_id.empty() && (!subitem || subitem->id != query.subitem_id)) continue;
+
+                ++stats.records_matched;
+                const LogEntry entry{record, category, subitem ? std::string_view(subitem->id) : std::string_view(),
+                                     subitem ? std::string_view(subitem->name) : std::string_view()};
+                if (!fn(entry)) return stats;
+            }
+            continue;
+        }
+
+        const auto skip_segment = [&] {
+            ++stats.segments_skipped;
+            stats.blocks_skipped += source->blocks.size();
+        };
+        if (source->blocks.empty() || source->last_timestamp < query.from || source->first_timestamp >= query.to) {
+            skip_segment();
+            continue;
+        }
+
+        // Ids are per process, so names are resolved per segment
+        const Dictionary& dictionary = source->dictionary;
+        std::vector<bool> wanted;
+        uint64_t category_mask = ~uint64_t{0};
+        if (!query.category.empty()) {
+            category_mask = 0;
+            for (const auto& [id, name] : dictionary.categories) {
+                if (!category_matches(name)) continue;
+                if (wanted.size() <= id) wanted.resize(id + 1);
+                wanted[id] = true;
+                category_mask |= bloom_bit(id);
+            }
+            if (category_mask == 0) {
+                skip_segment();
+                continue;
+            }
+        }
+        // Every index the dictionary gives the id, as for categories, not
+        // only the last one listed
+        std::vector<bool> wanted_subitems;
+        uint64_t subitem_mask = ~uint64_t{0};
+        if (!query.subitem_id.empty()) {
+            subitem_mask = 0;
+            for (const auto& [index, subitem] : dictionary.subitems) {
+                if (subitem.id != query.subitem_id) continue;
+                if (wanted_subitems.size() <= index) wanted_subitems.resize(index + 1);
+                wanted_subitems[index] = true;
+                subitem_mask |= bloom_bit(index);
+            }
+            if (subitem_mask == 0) {
+                skip_segment();
+                continue;
+            }
+        }
+
+        for (const Block& block : source->blocks) {
+            if (block.last_timestamp < query.from || block.first_timestamp >= query.to
+                || (block.levels & levels) == 0
+                || (block.categories & category_mask) == 0
+                || (!wanted_subitems.empty() && (block.subitems & subitem_mask) == 0)) {
+                ++stats.blocks_skipped;
+                continue;
+            }
+            ++stats.blocks_scanned;
+
+            for (uint64_t offset = block.begin; offset < block.end;) {
+                const RecordView record(source->file->data() + offset);
+                if (record.size() < sizeof(RecordHeader)) break;
+                offset += record.size();
+                ++stats.records_scanned;
+                if (!accept(record)) continue;
+                if (!wanted.empty() && (record.category_id() >= wanted.size() || !wanted[record.category_id()])) continue;
+                if (!wanted_subitems.empty()
+                    && (record.subitem() >= wanted_subitems.size() || !wanted_subitems[record.subitem()])) continue;
+
+                const auto category = dictionary.categories.find(record.category_id());
+                const auto subitem = dictionary.subitems.find(record.subitem());
+                const bool has_subitem = subitem != dictionary.subitems.end();
+                ++stats.records_matched;
+                const LogEntry entry{
+                    record,
+                    category != dictionary.categories.end() ? std::string_view(category->second) : std::string_view(),
+                    has_subitem ? std::string_view(subitem->second.id) : std::string_view(),
+                    has_subitem ? std::string_view(subitem->second.name) : std::string_view()};
+                if (!fn(entry)) return stats;
+            }
+        }
+    }
+    return stats;
+}
+
+} // namespace debugger
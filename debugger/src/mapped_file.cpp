@@ -0,0 +1,209 @@
+#include "mapped_file.hpp"
+#include <cstdint>
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace debugger {
+
+namespace {
+
+// msync and FlushViewOfFile want page-aligned start addresses
+size_t page_size() {
+#ifdef _WIN32
+    static const size_t size = [] {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwAllocationGranularity);
+    }();
+#else
+    static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+    return size;
+}
+
+} // namespace
+
+#ifdef _WIN32
+
+std::unique_ptr<MappedFile> MappedFile::create(const std::filesystem::path& path, size_t size) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+    // Mapping a file with an explicit size extends it to that size
+    const auto high = static_cast<DWORD>(static_cast<uint64_t>(size) >> 32);
+    const auto low = static_cast<DWORD>(size & 0xffffffffu);
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, high, low, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> result(new MappedFile());
+    result->path_ = path;
+    result->data_ = static_cast<std::byte*>(view);
+    result->size_ = size;
+    result->file_ = file;
+    result->mapping_ = mapping;
+    return result;
+}
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::filesystem::path& path, bool writable) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | (writable ? GENERIC_WRITE : 0),
+                              FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return nullptr;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> result(new MappedFile());
+    result->path_ = path;
+    result->data_ = static_cast<std::byte*>(view);
+    result->size_ = static_cast<size_t>(size.QuadPart);
+    result->file_ = file;
+    result->mapping_ = mapping;
+    return result;
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+        CloseHandle(file_);
+    }
+}
+
+void MappedFile::flush_async(size_t offset, size_t length) {
+    // FlushViewOfFile only starts the write-back; it does not wait for it
+    const size_t start = offset - offset % page_size();
+    FlushViewOfFile(data_ + start, length + (offset - start));
+}
+
+void MappedFile::flush(size_t offset, size_t length) {
+    flush_async(offset, length);
+    FlushFileBuffers(file_);
+}
+
+bool MappedFile::close(size_t size) {
+    if (!data_) return false;
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    data_ = nullptr;
+
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(size);
+    const bool truncated = SetFilePointerEx(file_, end, nullptr, FILE_BEGIN) && SetEndOfFile(file_);
+    CloseHandle(file_);
+    return truncated;
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::create(const std::filesystem::path& path, size_t size) {
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return nullptr;
+
+    // Allocate the blocks now so writing through the mapping never has to
+    // wait for the filesystem to find space
+#ifdef __linux__
+    const bool sized = ::posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0
+        || ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+#else
+    const bool sized = ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+    void* view = sized ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> result(new MappedFile());
+    result->path_ = path;
+    result->data_ = static_cast<std::byte*>(view);
+    result->size_ = size;
+    result->fd_ = fd;
+    return result;
+}
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::filesystem::path& path, bool writable) {
+    const int fd = ::open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    void* view = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> result(new MappedFile());
+    result->path_ = path;
+    result->data_ = static_cast<std::byte*>(view);
+    result->size_ = size;
+    result->fd_ = fd;
+    return result;
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        ::munmap(data_, size_);
+        ::close(fd_);
+    }
+}
+
+void MappedFile::flush_async(size_t offset, size_t length) {
+#ifdef __linux__
+    // msync(MS_ASYNC) is a no-op on Linux, so queue the range's dirty pages
+    // for write-back directly; like MS_ASYNC this does not wait for them
+    ::sync_file_range(fd_, static_cast<off_t>(offset), static_cast<off_t>(length), SYNC_FILE_RANGE_WRITE);
+#else
+    const size_t start = offset - offset % page_size();
+    ::msync(data_ + start, length + (offset - start), MS_ASYNC);
+#endif
+}
+
+void MappedFile::flush(size_t offset, size_t length) {
+    const size_t start = offset - offset % page_size();
+    ::msync(data_ + start, length + (offset - start), MS_SYNC);
+}
+
+bool MappedFile::close(size_t size) {
+    if (!data_) return false;
+    ::munmap(data_, size_);
+    data_ = nullptr;
+    const bool truncated = ::ftruncate(fd_, static_cast<off_t>(size)) == 0;
+    ::close(fd_);
+    return truncated;
+}
+
+#endif
+
+} // namespace debugger
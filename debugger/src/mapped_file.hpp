@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+namespace debugger {
+
+// A file mapped into memory in full. Writable mappings are shared, so what
+// is copied into data() reaches the file even if the process dies.
+class MappedFile {
+public:
+    // Create (or replace) a file of exactly size bytes, allocate its blocks
+    // up front and map it for writing. Returns null on failure.
+    static std::unique_ptr<MappedFile> create(const std::filesystem::path& path, size_t size);
+
+    // Map an existing file; null on failure or if it is empty
+    static std::unique_ptr<MappedFile> open(const std::filesystem::path& path, bool writable);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::byte* data() const { return data_; }
+    size_t size() const { return size_; }
+    const std::filesystem::path& path() const { return path_; }
+
+    // Start writing a range back to disk without waiting for it
+    void flush_async(size_t offset, size_t length);
+
+    // Write a range back to disk and wait for it
+    void flush(size_t offset, size_t length);
+
+    // Unmap and shrink the file to size bytes. If shrinking fails the file
+    // keeps its zero padding, which readers skip.
+    bool close(size_t size);
+
+private:
+    MappedFile() = default;
+
+    std::filesystem::path path_;
+    std::byte* data_{nullptr};
+    size_t size_{0};
+#ifdef _WIN32
+    void* file_{nullptr};
+    void* mapping_{nullptr};
+#else
+    int fd_{-1};
+#endif
+};
+
+} // namespace debugger
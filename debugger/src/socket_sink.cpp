@@ -0,0 +1,383 @@
+#include <debugger/socket_sink.hpp>
+#include <debugger/debugger.hpp>
+#include <algorithm>
+#include <string_view>
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#else
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <netdb.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <poll.h>
+#  include <sys/socket.h>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#endif
+
+namespace debugger {
+
+namespace {
+
+#ifdef _WIN32
+constexpr uintptr_t invalid_socket = INVALID_SOCKET;
+
+void close_socket(uintptr_t s) { ::closesocket(static_cast<SOCKET>(s)); }
+void shutdown_socket(uintptr_t s) { ::shutdown(static_cast<SOCKET>(s), SD_BOTH); }
+
+bool set_blocking(uintptr_t s, bool blocking) {
+    u_long mode = blocking ? 0 : 1;
+    return ::ioctlsocket(static_cast<SOCKET>(s), FIONBIO, &mode) == 0;
+}
+
+bool connect_in_progress() {
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+// Returns the events that occurred, or 0 on timeout or failure
+short poll_socket(uintptr_t s, short events, int timeout_ms) {
+    WSAPOLLFD entry{static_cast<SOCKET>(s), events, 0};
+    return ::WSAPoll(&entry, 1, timeout_ms) == 1 ? entry.revents : 0;
+}
+
+void ensure_winsock() {
+    static const bool started = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    (void)started;
+}
+#else
+constexpr int invalid_socket = -1;
+
+void close_socket(int s) { ::close(s); }
+void shutdown_socket(int s) { ::shutdown(s, SHUT_RDWR); }
+
+bool set_blocking(int s, bool blocking) {
+    const int flags = ::fcntl(s, F_GETFL, 0);
+    if (flags < 0) return false;
+    return ::fcntl(s, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) == 0;
+}
+
+bool connect_in_progress() {
+    return errno == EINPROGRESS;
+}
+
+// Returns the events that occurred, or 0 on timeout or failure. Unlike
+// select this has no limit on the descriptor's value
+short poll_socket(int s, short events, int timeout_ms) {
+    pollfd entry{s, events, 0};
+    int result;
+    do {
+        result = ::poll(&entry, 1, timeout_ms);
+    } while (result < 0 && errno == EINTR);
+    return result == 1 ? entry.revents : 0;
+}
+#endif
+
+// Most platforms accept at least this many buffers per vectored write
+constexpr size_t max_buffers_per_write = 64;
+
+} // namespace
+
+SocketSink::SocketSink(SocketSinkOptions options)
+    : options_(std::move(options))
+    , socket_(invalid_socket) {
+#ifdef _WIN32
+    ensure_winsock();
+#endif
+    // Everything before the payload is the same for every frame
+    frame_prefix_ = json{{"framework", options_.framework}, {"command", options_.command}}.dump();
+    frame_prefix_.pop_back();
+    frame_prefix_ += ",\"payload\":";
+
+    thread_ = std::thread([this] { run(); });
+}
+
+SocketSink::~SocketSink() {
+    {
+        std::unique_lock lock(mutex_);
+        stopping_ = true;
+        wake_.notify_all();
+
+        // Give the sender close_timeout to get the queue out, then cut the
+        // connection so a stalled peer cannot hold up destruction
+        if (!idle_.wait_for(lock, options_.close_timeout, [&] { return exited_; })) {
+            const auto s = socket_.load();
+            if (s != invalid_socket) {
+                shutdown_socket(s);
+            }
+        }
+    }
+    thread_.join();
+}
+
+void SocketSink::write(std::span<const RecordView> records, const BatchInfo& /*info*/) {
+    Chunk chunk;
+    chunk.bytes.reserve(records.size() * (frame_prefix_.size() + 128));
+    for (const auto& record : records) {
+        append_frame(chunk.bytes, record);
+    }
+    chunk.frames = records.size();
+
+    {
+        std::lock_guard lock(mutex_);
+        if (stopping_ || queued_bytes_ + chunk.bytes.size() > options_.max_queued_bytes) {
+            frames_dropped_.fetch_add(chunk.frames, std::memory_order_relaxed);
+            return;
+        }
+        queued_bytes_ += chunk.bytes.size();
+        queue_.push_back(std::move(chunk));
+    }
+    wake_.notify_one();
+}
+
+bool SocketSink::send_frames(std::string& bytes, size_t frames) {
+    {
+        std::lock_guard lock(mutex_);
+        if (stopping_ || queued_bytes_ + bytes.size() > options_.max_queued_bytes) return false;
+        queued_bytes_ += bytes.size();
+        queue_.push_back(Chunk{std::move(bytes), frames, 0});
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void SocketSink::append_frame(std::string& out, const RecordView& record) const {
+    json payload = Debugger::instance().to_json(record);
+    if (const Category* category = Debugger::instance().category(record.category_id())) {
+        payload["category"] = category->name();
+    }
+    payload["level"] = to_string(record.level());
+    payload["timestamp"] = record.timestamp();
+
+    out += frame_prefix_;
+    out += payload.dump(-1, ' ', false, json::error_handler_t::replace);
+    out += "}\n";
+}
+
+void SocketSink::flush() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&] {
+        return exited_ || (queue_.empty() && !sending_) || !connected_.load();
+    });
+}
+
+SocketSinkStats SocketSink::stats() const {
+    SocketSinkStats stats;
+    stats.frames_sent = frames_sent_.load(std::memory_order_relaxed);
+    stats.frames_dropped = frames_dropped_.load(std::memory_order_relaxed);
+    stats.bytes_sent = bytes_sent_.load(std::memory_order_relaxed);
+    stats.writes = writes_.load(std::memory_order_relaxed);
+    stats.connects = connects_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void SocketSink::run() {
+    auto delay = options_.reconnect_delay;
+    std::deque<Chunk> sending;
+
+    for (;;) {
+        if (socket_.load() == invalid_socket) {
+            {
+                std::lock_guard lock(mutex_);
+                if (stopping_) break;
+            }
+            if (!connect_once()) {
+                std::unique_lock lock(mutex_);
+                idle_.notify_all();
+                wake_.wait_for(lock, delay, [&] { return stopping_; });
+                delay = std::min(delay * 2, options_.max_reconnect_delay);
+                continue;
+            }
+            delay = options_.reconnect_delay;
+
+            // A partly written batch starts over on the new connection
+            if (!sending.empty()) {
+                sending.front().sent = 0;
+            }
+        }
+
+        if (sending.empty()) {
+            std::unique_lock lock(mutex_);
+            sending_ = false;
+            idle_.notify_all();
+            // A write is what notices a closed connection, so while idle
+            // look for one now and then: a UI that went away is reconnected
+            // to before the next batch rather than after losing it
+            if (!wake_.wait_for(lock, options_.reconnect_delay, [&] { return !queue_.empty() || stopping_; })) {
+                lock.unlock();
+                if (peer_closed()) {
+                    disconnect();
+                }
+                continue;
+            }
+            if (queue_.empty()) break;
+            sending.swap(queue_);
+            sending_ = true;
+        }
+
+        if (!send_chunks(sending)) {
+            disconnect();
+        }
+    }
+
+    disconnect();
+
+    // Whatever could not be sent before stopping is lost
+    std::lock_guard lock(mutex_);
+    for (const auto& chunk : sending) {
+        frames_dropped_.fetch_add(chunk.frames, std::memory_order_relaxed);
+    }
+    for (const auto& chunk : queue_) {
+        frames_dropped_.fetch_add(chunk.frames, std::memory_order_relaxed);
+    }
+    queue_.clear();
+    queued_bytes_ = 0;
+    sending_ = false;
+    exited_ = true;
+    idle_.notify_all();
+}
+
+bool SocketSink::connect_once() {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    addrinfo* addresses = nullptr;
+    const std::string port = std::to_string(options_.port);
+    if (::getaddrinfo(options_.host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        return false;
+    }
+
+    NativeSocket connected = invalid_socket;
+    for (addrinfo* address = addresses; address && connected == invalid_socket; address = address->ai_next) {
+        const auto s = static_cast<NativeSocket>(::socket(address->ai_family, address->ai_socktype, address->ai_protocol));
+        if (s == invalid_socket) continue;
+
+        // Connect without blocking so connect_timeout bounds the attempt
+        bool ok = set_blocking(s, false);
+        if (ok && ::connect(s, address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0) {
+            ok = connect_in_progress();
+            if (ok) {
+                const auto ms = static_cast<int>(options_.connect_timeout.count());
+                int error = 0;
+                socklen_t length = sizeof(error);
+                ok = poll_socket(s, POLLOUT, ms) != 0
+                    && ::getsockopt(s, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) == 0
+                    && error == 0;
+            }
+        }
+        if (ok && set_blocking(s, true)) {
+            connected = s;
+        } else {
+            close_socket(s);
+        }
+    }
+    ::freeaddrinfo(addresses);
+    if (connected == invalid_socket) return false;
+
+    // Frames are already coalesced, so send them without Nagle delays
+    int one = 1;
+    ::setsockopt(connected, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+#ifdef SO_NOSIGPIPE
+    ::setsockopt(connected, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    {
+        std::lock_guard lock(mutex_);
+        socket_.store(connected);
+    }
+    connected_.store(true);
+    connects_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool SocketSink::send_chunks(std::deque<Chunk>& chunks) {
+    const NativeSocket s = socket_.load();
+    while (!chunks.empty()) {
+        const size_t count = std::min(chunks.size(), max_buffers_per_write);
+        size_t written = 0;
+
+#ifdef _WIN32
+        WSABUF buffers[max_buffers_per_write];
+        for (size_t i = 0; i < count; ++i) {
+            buffers[i].buf = chunks[i].bytes.data() + chunks[i].sent;
+            buffers[i].len = static_cast<ULONG>(chunks[i].bytes.size() - chunks[i].sent);
+        }
+        DWORD sent = 0;
+        if (::WSASend(static_cast<SOCKET>(s), buffers, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) != 0) {
+            return false;
+        }
+        written = sent;
+#else
+        iovec buffers[max_buffers_per_write];
+        for (size_t i = 0; i < count; ++i) {
+            buffers[i].iov_base = chunks[i].bytes.data() + chunks[i].sent;
+            buffers[i].iov_len = chunks[i].bytes.size() - chunks[i].sent;
+        }
+        msghdr message{};
+        message.msg_iov = buffers;
+        message.msg_iovlen = count;
+#  ifdef MSG_NOSIGNAL
+        constexpr int flags = MSG_NOSIGNAL;
+#  else
+        constexpr int flags = 0;
+#  endif
+        const ssize_t sent = ::sendmsg(s, &message, flags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written = static_cast<size_t>(sent);
+#endif
+
+        writes_.fetch_add(1, std::memory_order_relaxed);
+        bytes_sent_.fetch_add(written, std::memory_order_relaxed);
+
+        size_t finished_bytes = 0;
+        while (written > 0) {
+            Chunk& chunk = chunks.front();
+            const size_t take = std::min(written, chunk.bytes.size() - chunk.sent);
+            chunk.sent += take;
+            written -= take;
+            if (chunk.sent == chunk.bytes.size()) {
+                frames_sent_.fetch_add(chunk.frames, std::memory_order_relaxed);
+                finished_bytes += chunk.bytes.size();
+                chunks.pop_front();
+            }
+        }
+
+        std::lock_guard lock(mutex_);
+        queued_bytes_ -= finished_bytes;
+    }
+    return true;
+}
+
+bool SocketSink::peer_closed() {
+    // Readable with nothing to read means the other end closed or reset it;
+    // anything it did send is left where it is
+    const NativeSocket s = socket_.load();
+    if (poll_socket(s, POLLIN, 0) == 0) return false;
+    char byte;
+    return ::recv(s, &byte, 1, MSG_PEEK) <= 0;
+}
+
+void SocketSink::disconnect() {
+    // Under mutex_ so the destructor never shuts down a reused descriptor
+    std::lock_guard lock(mutex_);
+    const NativeSocket s = socket_.exchange(invalid_socket);
+    if (s != invalid_socket) {
+        close_socket(s);
+    }
+    connected_.store(false);
+}
+
+} // namespace debugger
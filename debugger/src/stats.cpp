@@ -0,0 +1,112 @@
+#include <debugger/stats.hpp>
+#include <algorithm>
+#include <unordered_map>
+
+namespace debugger {
+
+namespace {
+
+nlohmann::json histogram_json(const LatencyHistogram& histogram) {
+    return {
+        {"count", histogram.count},
+        {"mean_ns", histogram.mean()},
+        {"p50_ns", histogram.percentile(0.50)},
+        {"p99_ns", histogram.percentile(0.99)},
+        {"p999_ns", histogram.percentile(0.999)},
+        {"max_ns", histogram.max}
+    };
+}
+
+// Traffic since the previous snapshot, per second
+template<typename Key>
+double rate(const std::unordered_map<Key, uint64_t>& before, Key key, uint64_t now, double seconds) {
+    const auto it = before.find(key);
+    const uint64_t base = it != before.end() ? it->second : 0;
+    return seconds > 0 && now >= base ? static_cast<double>(now - base) / seconds : 0.0;
+}
+
+void sort_by_rate(nlohmann::json& entries) {
+    std::stable_sort(entries.begin(), entries.end(), [](const nlohmann::json& a, const nlohmann::json& b) {
+        return a["messages_per_second"].get<double>() > b["messages_per_second"].get<double>();
+    });
+}
+
+} // namespace
+
+nlohmann::json to_json(const DebuggerStats& stats, const DebuggerStats* previous) {
+    nlohmann::json lanes = nlohmann::json::array();
+    for (const auto& lane : stats.lanes) {
+        lanes.push_back({
+            {"lane", lane.index},
+            {"queue_depth", lane.queue_depth},
+            {"high_water", lane.high_water},
+            {"staged_batches", lane.staged_batches},
+            {"dispatched", lane.dispatched},
+            {"dispatch_lag", histogram_json(lane.dispatch_lag)},
+            {"error_lag", histogram_json(lane.error_lag)},
+            {"batch_time", histogram_json(lane.batch_time)}
+        });
+    }
+
+    double seconds = 0;
+    std::unordered_map<uint32_t, uint64_t> category_before;
+    std::unordered_map<uint64_t, uint64_t> subitem_before;
+    if (previous) {
+        seconds = std::chrono::duration<double>(stats.taken - previous->taken).count();
+        for (const auto& category : previous->categories) category_before[category.id] = category.messages;
+        for (const auto& subitem : previous->subitems) subitem_before[subitem.index] = subitem.messages;
+    }
+
+    nlohmann::json categories = nlohmann::json::array();
+    for (const auto& category : stats.categories) {
+        nlohmann::json entry = {
+            {"category", category.name},
+            {"messages", category.messages},
+            {"dropped", category.dropped},
+            {"overwritten", category.overwritten},
+            {"collapsed", category.collapsed},
+            {"suppressed", category.suppressed},
+            {"sample_probability", category.sample_probability},
+            {"handler_time", histogram_json(category.handler_time)}
+        };
+        if (previous) {
+            entry["messages_per_second"] = rate(category_before, category.id, category.messages, seconds);
+        }
+        categories.push_back(std::move(entry));
+    }
+
+    nlohmann::json subitems = nlohmann::json::array();
+    for (const auto& subitem : stats.subitems) {
+        nlohmann::json entry = {
+            {"subitem_id", subitem.id},
+            {"subitem_name", subitem.name},
+            {"category", subitem.category},
+            {"messages", subitem.messages}
+        };
+        if (previous) {
+            entry["messages_per_second"] = rate(subitem_before, subitem.index, subitem.messages, seconds);
+        }
+        subitems.push_back(std::move(entry));
+    }
+
+    if (previous) {
+        sort_by_rate(categories);
+        sort_by_rate(subitems);
+    }
+
+    nlohmann::json result = {
+        {"queue_depth", stats.queue_depth()},
+        {"enqueue_wait", histogram_json(stats.enqueue_wait)},
+        {"dispatch_lag", histogram_json(stats.dispatch_lag)},
+        {"error_lag", histogram_json(stats.error_lag)},
+        {"lanes", std::move(lanes)},
+        {"categories", std::move(categories)},
+        {"subitems", std::move(subitems)}
+    };
+    if (previous) {
+        result["interval_seconds"] = seconds;
+    }
+    return result;
+}
+
+} // namespace debugger
@@ -1,4 +1,5 @@
 #include <debugger/subscriber.hpp>
+#include <debugger/debugger.hpp>
 
 namespace debugger {
 
@@ -10,21 +11,88 @@ DebugSubscriber::~DebugSubscriber() {
 }
 
 void DebugSubscriber::subscribe(Callback callback) {
-    std::lock_guard lock(mutex_);
-    callback_ = std::move(callback);
-    subscribed_ = true;
+    {
+        std::lock_guard lock(mutex_);
+        callback_ = callback ? std::make_shared<const Callback>(std::move(callback)) : nullptr;
+        batch_sink_ = nullptr;
+    }
+    notify_change();
+}
+
+void DebugSubscriber::subscribe_batch(BatchCallback callback, BatchOptions options) {
+    std::shared_ptr<const BatchSink> sink;
+    if (callback) {
+        // The debugger routes encoded records; convert each batch once here
+        auto handler = [callback = std::move(callback)](std::span<const RecordView> records, const BatchInfo& info) {
+            std::vector<json> messages;
+            messages.reserve(records.size());
+            for (const auto& record : records) {
+                messages.push_back(Debugger::instance().to_json(record));
+            }
+            callback(messages, info);
+        };
+        sink = std::make_shared<const BatchSink>(BatchSink{std::move(handler), options});
+    }
+    
+    {
+        std::lock_guard lock(mutex_);
+        callback_ = nullptr;
+        batch_sink_ = std::move(sink);
+    }
+    notify_change();
+}
+
+void DebugSubscriber::subscribe_records(BatchHandler handler, BatchOptions options) {
+    auto sink = handler ? std::make_shared<const BatchSink>(BatchSink{std::move(handler), options}) : nullptr;
+    {
+        std::lock_guard lock(mutex_);
+        callback_ = nullptr;
+        batch_sink_ = std::move(sink);
+    }
+    notify_change();
 }
 
 void DebugSubscriber::unsubscribe() {
-    std::lock_guard lock(mutex_);
-    subscribed_ = false;
-    callback_ = nullptr;
+    {
+        std::lock_guard lock(mutex_);
+        if (!callback_ && !batch_sink_) return;
+        callback_ = nullptr;
+        batch_sink_ = nullptr;
+    }
+    notify_change();
 }
 
 void DebugSubscriber::deliver(const json& message) {
+    auto current = callback();
+    if (current) {
+        (*current)(message);
+    }
+}
+
+std::shared_ptr<const DebugSubscriber::Callback> DebugSubscriber::callback() const {
+    std::lock_guard lock(mutex_);
+    return callback_;
+}
+
+std::shared_ptr<const BatchSink> DebugSubscriber::batch_sink() const {
     std::lock_guard lock(mutex_);
-    if (subscribed_ && callback_) {
-        callback_(message);
+    return batch_sink_;
+}
+
+void DebugSubscriber::set_change_listener(std::function<void()> listener) {
+    std::lock_guard lock(mutex_);
+    on_change_ = std::move(listener);
+}
+
+void DebugSubscriber::notify_change() {
+    // Called without mutex_ held so the listener may read callback()
+    std::function<void()> listener;
+    {
+        std::lock_guard lock(mutex_);
+        listener = on_change_;
+    }
+    if (listener) {
+        listener();
     }
 }
 
@@ -0,0 +1,134 @@
+#include <debugger/throttle.hpp>
+#include <algorithm>
+#include <utility>
+
+namespace debugger {
+
+namespace {
+
+constexpr double nanoseconds_per_second = 1e9;
+
+uint64_t window_ns(const ThrottleOptions& options) {
+    return static_cast<uint64_t>(std::chrono::nanoseconds(options.report_window).count());
+}
+
+// Timestamps come from several threads, so they may be slightly out of order
+uint64_t elapsed(uint64_t from, uint64_t to) {
+    return to > from ? to - from : 0;
+}
+
+double burst_of(const ThrottleOptions& options) {
+    return std::max(options.burst > 0 ? options.burst : options.rate, 1.0);
+}
+
+} // namespace
+
+Throttle::Throttle(const ThrottleOptions& options) {
+    configure(options);
+}
+
+void Throttle::configure(const ThrottleOptions& options) {
+    std::lock_guard lock(mutex_);
+    options_ = options;
+    tokens_ = burst_of(options);
+    refilled_ = 0;
+    if (!options.collapse_repeats) {
+        has_last_ = false;
+    }
+}
+
+bool Throttle::admit(Level level, uint64_t subitem, std::string_view message, uint64_t timestamp,
+                     ThrottleReport& report) {
+    std::lock_guard lock(mutex_);
+
+    if (options_.collapse_repeats) {
+        if (has_last_ && level == last_level_ && subitem == last_subitem_ && message == last_message_) {
+            if (repeats_++ == 0) {
+                first_repeat_ = timestamp;
+            }
+            last_repeat_ = timestamp;
+            ++total_collapsed_;
+            if (elapsed(first_repeat_, timestamp) >= window_ns(options_)) {
+                take_repeats(report);
+            }
+            return false;
+        }
+        take_repeats(report);
+    }
+
+    if (options_.rate > 0) {
+        if (refilled_ != 0 && timestamp > refilled_) {
+            tokens_ = std::min(burst_of(options_),
+                               tokens_ + static_cast<double>(elapsed(refilled_, timestamp)) * options_.rate
+                                             / nanoseconds_per_second);
+        }
+        refilled_ = std::max(refilled_, timestamp);
+        if (tokens_ < 1) {
+            if (suppressed_++ == 0) {
+                first_suppressed_ = timestamp;
+            }
+            ++total_suppressed_;
+            return false;
+        }
+        tokens_ -= 1;
+        report.suppressed = std::exchange(suppressed_, 0);
+    }
+
+    if (options_.collapse_repeats) {
+        has_last_ = true;
+        last_level_ = level;
+        last_subitem_ = subitem;
+        last_message_.assign(message);
+    }
+    return true;
+}
+
+bool Throttle::take_stale(uint64_t now, bool force, ThrottleReport& report) {
+    std::lock_guard lock(mutex_);
+    const uint64_t window = window_ns(options_);
+    if (repeats_ > 0 && (force || elapsed(first_repeat_, now) >= window)) {
+        // The next identical record starts a new run rather than going out
+        // in full again
+        take_repeats(report);
+    }
+    if (suppressed_ > 0 && (force || elapsed(first_suppressed_, now) >= window)) {
+        report.suppressed = std::exchange(suppressed_, 0);
+    }
+    return report.repeats > 0 || report.suppressed > 0;
+}
+
+uint64_t Throttle::due() const {
+    std::lock_guard lock(mutex_);
+    const uint64_t window = window_ns(options_);
+    uint64_t due = 0;
+    if (repeats_ > 0) {
+        due = first_repeat_ + window;
+    }
+    if (suppressed_ > 0) {
+        due = due ? std::min(due, first_suppressed_ + window) : first_suppressed_ + window;
+    }
+    return due;
+}
+
+uint64_t Throttle::collapsed() const {
+    std::lock_guard lock(mutex_);
+    return total_collapsed_;
+}
+
+uint64_t Throttle::suppressed() const {
+    std::lock_guard lock(mutex_);
+    return total_suppressed_;
+}
+
+void Throttle::take_repeats(ThrottleReport& report) {
+    // Caller holds mutex_
+    if (repeats_ == 0) return;
+    report.repeats = std::exchange(repeats_, 0);
+    report.level = last_level_;
+    report.subitem = last_subitem_;
+    report.message = last_message_;
+    report.first_timestamp = first_repeat_;
+    report.last_timestamp = last_repeat_;
+}
+
+} // namespace debugger
@@ -0,0 +1,138 @@
+#include <debugger/trace_sink.hpp>
+#include <debugger/debugger.hpp>
+#include <cinttypes>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#  include <process.h>
+#else
+#  include <unistd.h>
+#endif
+
+namespace debugger {
+
+namespace {
+
+int current_pid() {
+#ifdef _WIN32
+    return _getpid();
+#else
+    return static_cast<int>(::getpid());
+#endif
+}
+
+// Trace events count in microseconds; keep the nanoseconds as decimals
+void append_microseconds(std::string& out, uint64_t ns) {
+    char text[32];
+    const int length = std::snprintf(text, sizeof(text), "%" PRIu64 ".%03" PRIu64, ns / 1000, ns % 1000);
+    out.append(text, static_cast<size_t>(length));
+}
+
+void append_string(std::string& out, std::string_view text) {
+    out += json(text).dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+} // namespace
+
+TraceSink::TraceSink(TraceSinkOptions options)
+    : options_(std::move(options))
+    , pid_(current_pid()) {
+    std::error_code error;
+    if (options_.path.has_parent_path()) {
+        std::filesystem::create_directories(options_.path.parent_path(), error);
+    }
+    file_ = std::fopen(options_.path.string().c_str(), "wb");
+    if (file_) {
+        std::fputs("[\n", file_);
+    }
+}
+
+TraceSink::~TraceSink() {
+    if (!file_) return;
+    std::fputs("\n]\n", file_);
+    std::fclose(file_);
+}
+
+void TraceSink::write(std::span<const RecordView> records, const BatchInfo&) {
+    std::lock_guard lock(mutex_);
+    if (!file_) return;
+    buffer_.clear();
+    for (const RecordView& record : records) {
+        if (record.dictionary() || (!record.span() && !options_.include_messages)) continue;
+        if (events_++ > 0) {
+            buffer_ += ",\n";
+        }
+        append_event(buffer_, record);
+    }
+    if (!buffer_.empty()) {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    }
+}
+
+void TraceSink::flush() {
+    std::lock_guard lock(mutex_);
+    if (file_) {
+        std::fflush(file_);
+    }
+}
+
+uint64_t TraceSink::events_written() const {
+    std::lock_guard lock(mutex_);
+    return events_;
+}
+
+void TraceSink::append_event(std::string& out, const RecordView& record) const {
+    const Debugger& debugger = Debugger::instance();
+    const Category* category = debugger.category(record.category_id());
+    const Debugger::SubitemInfo* subitem = record.subitem() ? debugger.subitem_info(record.subitem()) : nullptr;
+
+    out += "{\"name\":";
+    append_string(out, record.message());
+    out += ",\"cat\":";
+    append_string(out, category ? std::string_view(category->name()) : std::string_view());
+
+    if (record.span()) {
+        uint64_t begin = record.timestamp(), duration = 0, thread = 0, span_id = 0, parent_id = 0;
+        record.for_each_field([&](const FieldView& field) {
+            if (field.type() != FieldType::uint64) return;
+            const std::string_view key = field.key();
+            if (key == "begin") begin = field.as_uint();
+            else if (key == "duration") duration = field.as_uint();
+            else if (key == "thread") thread = field.as_uint();
+            else if (key == "span_id") span_id = field.as_uint();
+            else if (key == "parent_id") parent_id = field.as_uint();
+        });
+
+        out += ",\"ph\":\"X\",\"ts\":";
+        append_microseconds(out, begin);
+        out += ",\"dur\":";
+        append_microseconds(out, duration);
+        out += ",\"pid\":" + std::to_string(pid_);
+        out += ",\"tid\":" + std::to_string(thread);
+        out += ",\"args\":{\"span_id\":" + std::to_string(span_id);
+        out += ",\"parent_id\":" + std::to_string(parent_id);
+        if (subitem) {
+            out += ",\"subitem\":";
+            append_string(out, subitem->name);
+        }
+        out += "}}";
+        return;
+    }
+
+    // Other records carry no thread, so they become process-wide instant
+    // events
+    out += ",\"ph\":\"i\",\"s\":\"p\",\"ts\":";
+    append_microseconds(out, record.timestamp());
+    out += ",\"pid\":" + std::to_string(pid_);
+    out += ",\"tid\":0,\"args\":";
+    json args = debugger.to_json(record);
+    if (!args.is_object()) {
+        args = json{{"data", std::move(args)}};
+    }
+    args["level"] = to_string(record.level());
+    out += args.dump(-1, ' ', false, json::error_handler_t::replace);
+    out += "}";
+}
+
+} // namespace debugger
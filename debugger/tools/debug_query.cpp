@@ -0,0 +1,179 @@
+#include <debugger/log_reader.hpp>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace debugger;
+using json = nlohmann::json;
+
+// Queries segment files written by FileSink (and flight recorder files) and
+// prints the matching records as JSON lines:
+//
+//   debug_query --category application.DatabaseModule --level error
+//               --from 2025-03-01T10:00:00Z --to 2025-03-01T10:05:00Z logs/
+
+namespace {
+
+void usage() {
+    std::cerr <<
+        "usage: debug_query [options] <directory|file>...\n"
+        "  --category NAME     category name or pattern (application.*, application.**)\n"
+        "  --subitem ID        subitem id string\n"
+        "  --level LEVEL       debug, info, warning or error; this level and above\n"
+        "  --from TIME         start, inclusive\n"
+        "  --to TIME           end, exclusive\n"
+        "  --limit N           stop after N records\n"
+        "  --stats             print index statistics to stderr\n"
+        "  --no-index-cache    do not save segment indexes next to the segments\n"
+        "TIME is nanoseconds since the Unix epoch or UTC as YYYY-MM-DDTHH:MM:SS[.fraction][Z]\n";
+}
+
+std::optional<Level> parse_level(std::string_view text) {
+    for (Level level : {Level::debug, Level::info, Level::warning, Level::error}) {
+        if (text == to_string(level)) return level;
+    }
+    return std::nullopt;
+}
+
+std::optional<uint64_t> parse_time(const std::string& text) {
+    if (!text.empty() && text.find_first_not_of("0123456789") == std::string::npos) {
+        return std::stoull(text);
+    }
+
+    int year, month, day, hour = 0, minute = 0, second = 0, consumed = 0;
+    if (std::sscanf(text.c_str(), "%d-%d-%dT%d:%d:%d%n", &year, &month, &day, &hour, &minute, &second, &consumed) < 6) {
+        consumed = 0;
+        if (std::sscanf(text.c_str(), "%d-%d-%d%n", &year, &month, &day, &consumed) < 3) return std::nullopt;
+    }
+
+    // Up to nine fraction digits, then an optional Z
+    uint64_t fraction = 0;
+    size_t position = static_cast<size_t>(consumed);
+    if (position < text.size() && text[position] == '.') {
+        uint64_t scale = 100000000;
+        for (++position; position < text.size() && text[position] >= '0' && text[position] <= '9'; ++position) {
+            fraction += static_cast<uint64_t>(text[position] - '0') * scale;
+            scale /= 10;
+        }
+    }
+    if (position < text.size() && text[position] == 'Z') ++position;
+    if (position != text.size()) return std::nullopt;
+
+    const std::chrono::year_month_day date{std::chrono::year(year), std::chrono::month(static_cast<unsigned>(month)),
+                                           std::chrono::day(static_cast<unsigned>(day))};
+    if (!date.ok()) return std::nullopt;
+    const auto time = std::chrono::sys_days(date) + std::chrono::hours(hour)
+                    + std::chrono::minutes(minute) + std::chrono::seconds(second);
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        time.time_since_epoch()).count()) + fraction;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    LogQuery query;
+    LogReaderOptions options;
+    std::vector<std::filesystem::path> paths;
+    uint64_t limit = 0;
+    bool print_stats = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const auto value = [&]() -> std::optional<std::string> {
+            if (i + 1 >= argc) return std::nullopt;
+            return std::string(argv[++i]);
+        };
+
+        if (arg == "--category" || arg == "--subitem" || arg == "--level"
+            || arg == "--from" || arg == "--to" || arg == "--limit") {
+            const auto text = value();
+            if (!text) {
+                std::cerr << arg << " needs a value\n";
+                return 2;
+            }
+            if (arg == "--category") {
+                query.category = *text;
+            } else if (arg == "--subitem") {
+                query.subitem_id = *text;
+            } else if (arg == "--level") {
+                const auto level = parse_level(*text);
+                if (!level) {
+                    std::cerr << "unknown level: " << *text << "\n";
+                    return 2;
+                }
+                query.min_level = *level;
+            } else if (arg == "--limit") {
+                limit = std::stoull(*text);
+            } else {
+                const auto time = parse_time(*text);
+                if (!time) {
+                    std::cerr << "cannot parse time: " << *text << "\n";
+                    return 2;
+                }
+                (arg == "--from" ? query.from : query.to) = *time;
+            }
+        } else if (arg == "--stats") {
+            print_stats = true;
+        } else if (arg == "--no-index-cache") {
+            options.cache_index = false;
+        } else if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        } else if (arg.starts_with("--")) {
+            std::cerr << "unknown option: " << arg << "\n";
+            usage();
+            return 2;
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        usage();
+        return 2;
+    }
+
+    LogReader reader(paths, options);
+    if (reader.files().empty()) {
+        std::cerr << "no segment or flight recorder files found\n";
+        return 1;
+    }
+
+    std::ios::sync_with_stdio(false);
+    uint64_t printed = 0;
+    const auto stats = reader.query(query, [&](const LogEntry& entry) {
+        json line = {
+            {"timestamp", entry.record.timestamp()},
+            {"sequence", entry.record.sequence()},
+            {"category", entry.category},
+            {"level", to_string(entry.record.level())},
+            {"message", entry.record.message()},
+            {"data", entry.record.data()}
+        };
+        if (!entry.subitem_id.empty()) {
+            line["subitem_id"] = entry.subitem_id;
+            line["subitem_name"] = entry.subitem_name;
+        }
+        if (entry.record.sample_weight() != 1.0f) {
+            line["sample_weight"] = entry.record.sample_weight();
+        }
+        std::cout << line.dump(-1, ' ', false, json::error_handler_t::replace) << '\n';
+        return limit == 0 || ++printed < limit;
+    });
+    std::cout.flush();
+
+    if (print_stats) {
+        std::cerr << "files " << reader.files().size()
+                  << ", segments skipped " << stats.segments_skipped
+                  << ", blocks skipped " << stats.blocks_skipped
+                  << ", blocks scanned " << stats.blocks_scanned
+                  << ", records scanned " << stats.records_scanned
+                  << ", matched " << stats.records_matched << "\n";
+    }
+    return 0;
+}